@@ -1,6 +1,8 @@
 #include <GL/glew.h>
 #include <GL/glut.h>
 
+#include <algorithm>
+#include <iostream>
 #include <string>
 #include "imgui.h"
 
@@ -28,6 +30,11 @@ void Application::init()
     frameRate = 0.0f;
 
     mouseSensitivity = 0.01f;
+
+    recordingPath = false;
+    playingBack = false;
+    playbackFrame = 0;
+    playbackMs = 0.0;
 }
 
 bool Application::loadScene(const std::string &filename)
@@ -35,9 +42,67 @@ bool Application::loadScene(const std::string &filename)
     return scene.loadScene(filename);
 }
 
+// Time between the frames of a camera path playback, in milliseconds
+constexpr int PLAYBACK_TIMESTEP = 16;
+
+// Frames whose stage times are written by the P key, and where
+constexpr int DUMPED_FRAMES = 600;
+const std::string FRAME_TIMES_FILENAME = "frame_times.csv";
+
+bool Application::startPlayback(const std::string &pathFilename, const std::string &csvFilename)
+{
+    if (!path.load(pathFilename))
+    {
+        std::cerr << "Couldn't read the camera path " << pathFilename << std::endl;
+        return false;
+    }
+    playbackCsv.open(csvFilename);
+    if (!playbackCsv.is_open())
+    {
+        std::cerr << "Couldn't write " << csvFilename << std::endl;
+        return false;
+    }
+
+    playbackCsv << "frame,frame_ms,triangles,draws,pvs";
+    for (int lod = 0; lod < scene.getMaxLodCount(); ++lod)
+        playbackCsv << ",lod" << lod;
+    playbackCsv << std::endl;
+
+    scene.setDeterministic(true);
+    playingBack = true;
+    playbackFrame = 0;
+    playbackMs = 0.0;
+    return true;
+}
+
+bool Application::isPlayingBack() const
+{
+    return playingBack;
+}
+
+void Application::stopLoading()
+{
+    scene.stopLoading();
+}
+
 bool Application::update(int deltaTime)
 {
+    scene.getProfiler().beginFrame();
+    if (playingBack)
+    {
+        if (playbackFrame == path.getFrameCount())
+        {
+            std::cout << "Played " << playbackFrame << " frames, " << playbackMs / std::max(playbackFrame, 1) << " ms per frame" << std::endl;
+            playbackCsv.close();
+            return false;
+        }
+        frameStart = std::chrono::steady_clock::now();
+        deltaTime = PLAYBACK_TIMESTEP;
+    }
+
     scene.update(deltaTime);
+    if (playingBack)
+        scene.setPathFrame(path.getFrame(playbackFrame++));
     updateFrameRate(deltaTime);
     return bPlay;
 }
@@ -60,8 +125,42 @@ void Application::render()
     scene.render();
     
     if(ImGui::Begin("Performance statistics"))
+    {
         ImGui::Text("%g fps", frameRate);
+        scene.renderStatistics();
+        scene.getProfiler().renderStatistics();
+        if (!playingBack && ImGui::Checkbox("Record camera path", &recordingPath))
+        {
+            if (recordingPath)
+                path.clear();
+            else if (path.save(CAMERA_PATH_FILENAME))
+                std::cout << "Recorded " << path.getFrameCount() << " frames to " << CAMERA_PATH_FILENAME << std::endl;
+            else
+                std::cerr << "Couldn't write " << CAMERA_PATH_FILENAME << std::endl;
+        }
+    }
     ImGui::End();
+
+    if (recordingPath)
+        path.add(scene.getPathFrame());
+}
+
+void Application::endFrame()
+{
+    if (!playingBack || playbackFrame == 0)
+        return;
+
+    // The whole frame, until the GPU is done with it
+    glFinish();
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    playbackMs += milliseconds;
+
+    FrameStatistics statistics;
+    scene.getFrameStatistics(statistics);
+    playbackCsv << playbackFrame - 1 << "," << milliseconds << "," << statistics.triangles << "," << statistics.draws << "," << statistics.potentiallyVisible;
+    for (int count : statistics.lodHistogram)
+        playbackCsv << "," << count;
+    playbackCsv << "\n";
 }
 
 void Application::resize(int width, int height)
@@ -74,6 +173,13 @@ void Application::keyPressed(int key)
 {
     if (key == 27) // Escape code
         bPlay = false;
+    if (key == 'p' && !keys[key])
+    {
+        if (scene.getProfiler().dump(FRAME_TIMES_FILENAME, DUMPED_FRAMES))
+            std::cout << "Wrote the stage times of the last frames to " << FRAME_TIMES_FILENAME << std::endl;
+        else
+            std::cerr << "Couldn't write " << FRAME_TIMES_FILENAME << std::endl;
+    }
     keys[key] = true;
 }
 
@@ -126,3 +232,8 @@ bool Application::getSpecialKey(int key) const
 {
     return specialKeys[key];
 }
+
+FrameProfiler &Application::getProfiler()
+{
+    return scene.getProfiler();
+}
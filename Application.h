@@ -1,8 +1,12 @@
 #ifndef _APPLICATION_INCLUDE
 #define _APPLICATION_INCLUDE
 
+#include "CameraPath.h"
 #include "Scene.h"
 
+#include <chrono>
+#include <fstream>
+
 // Application is a singleton (a class with a single instance) that represents our whole app
 
 class Application
@@ -22,6 +26,14 @@ public:
     bool loadScene(const std::string &filename);
     bool update(int deltaTime);
     void render();
+    void endFrame(); // After everything has been drawn, before swapping buffers
+
+    // Replays the camera path at a fixed timestep instead of taking input, writing the statistics of every frame
+    bool startPlayback(const std::string &pathFilename, const std::string &csvFilename);
+    bool isPlayingBack() const;
+
+    // Stops the background work before exiting, so that nothing is traced while the trace is written
+    void stopLoading();
 
     void resize(int width, int height);
 
@@ -37,6 +49,8 @@ public:
     bool getKey(int key) const;
     bool getSpecialKey(int key) const;
 
+    FrameProfiler &getProfiler();
+
 private:
 
     void updateFrameRate(int deltaTime);
@@ -58,6 +72,15 @@ private:
 
     bool debugColors;
 
+    // Camera path recording and playback
+    CameraPath path;
+    bool recordingPath;
+    bool playingBack;
+    int playbackFrame; // Next frame of the path to replay
+    std::ofstream playbackCsv;
+    std::chrono::steady_clock::time_point frameStart;
+    double playbackMs; // Sum of the frame times
+
 };
 
 #endif // _APPLICATION_INCLUDE
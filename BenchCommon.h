@@ -0,0 +1,61 @@
+#ifndef BENCHCOMMON_H
+#define BENCHCOMMON_H
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Helpers shared by the command line benchmarks that run the CPU side of the
+// viewer over synthetic museums, without a window.
+
+// Mean and worst time of a stage over the frames of a run
+struct StageTimes
+{
+    double total;
+    float worst;
+
+    void add(float milliseconds)
+    {
+        total += milliseconds;
+        worst = std::max(worst, milliseconds);
+    }
+};
+
+inline void printStage(const char *name, const StageTimes &times, int frames)
+{
+    std::cout << "\t\t" << name << times.total / frames << " ms mean, " << times.worst << " ms max" << std::endl;
+}
+
+// The projection of a 16:9 window
+inline glm::mat4 benchProjection()
+{
+    return glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.01f, 100.0f);
+}
+
+struct BenchCamera
+{
+    glm::vec3 position;
+    glm::mat4 view;
+};
+
+// Camera of the given frame in a museum of size x size cells: a full circle
+// around its center over all frames, looking around four times
+inline BenchCamera walkCircle(int frame, int frames, float size)
+{
+    glm::vec2 center(0.5f * size);
+    float radius = 0.35f * size;
+    float angle = glm::two_pi<float>() * frame / frames;
+    float look = 4.0f * angle;
+
+    BenchCamera camera;
+    camera.position = glm::vec3(center.x + radius * std::cos(angle), 0.5f, center.y + radius * std::sin(angle));
+    camera.view = glm::lookAt(camera.position, camera.position + glm::vec3(std::cos(look), 0.0f, std::sin(look)), glm::vec3(0.0f, 1.0f, 0.0f));
+    return camera;
+}
+
+#endif // BENCHCOMMON_H
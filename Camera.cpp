@@ -52,6 +52,14 @@ void Camera::rotateCamera(float xRotation, float yRotation)
     updateLookDirection();
 }
 
+void Camera::setPose(const glm::vec3 &position, float theta, float phi)
+{
+    this->position = position;
+    this->theta = theta;
+    this->phi = phi;
+    updateLookDirection();
+}
+
 void Camera::updateLookDirection()
 {
     lookDirection = glm::vec3(glm::cos(phi) * glm::cos(theta) ,glm::sin(phi), -glm::cos(phi) * glm::sin(theta));
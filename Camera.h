@@ -20,6 +20,9 @@ public:
     glm::mat4 &getProjectionMatrix();
     glm::mat4 &getViewMatrix();
     const glm::vec3 &getPosition() const {return position;}
+    float getTheta() const {return theta;}
+    float getPhi() const {return phi;}
+    void setPose(const glm::vec3 &position, float theta, float phi);
 private:
     void moveForward(float input, float deltaTime);
     void moveRight(float input, float deltaTime);
@@ -0,0 +1,87 @@
+#include "CameraPath.h"
+
+#include <cstring>
+#include <fstream>
+
+constexpr char MAGIC[4] = {'C', 'P', 'T', 'H'};
+constexpr uint32_t VERSION = 1;
+
+// Bytes of a frame in the file: position, angles, TPS and FPS, then the debug colors flag
+constexpr size_t FRAME_SIZE = 7 * sizeof(float) + sizeof(uint8_t);
+
+void CameraPath::clear()
+{
+    frames.clear();
+}
+
+void CameraPath::add(const CameraPathFrame &frame)
+{
+    frames.push_back(frame);
+}
+
+bool CameraPath::save(const std::string &filename) const
+{
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout.is_open())
+        return false;
+
+    uint32_t count = frames.size();
+    fout.write(MAGIC, sizeof(MAGIC));
+    fout.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+    fout.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    for (const CameraPathFrame &frame : frames)
+    {
+        // Field by field, without the padding of the struct
+        float values[7] = {frame.position.x, frame.position.y, frame.position.z, frame.theta, frame.phi, frame.TPS, frame.FPS};
+        fout.write(reinterpret_cast<const char *>(values), sizeof(values));
+        fout.write(reinterpret_cast<const char *>(&frame.debugColors), sizeof(frame.debugColors));
+    }
+    return bool(fout);
+}
+
+bool CameraPath::load(const std::string &filename)
+{
+    std::ifstream fin(filename, std::ios::binary);
+    char magic[4];
+    uint32_t version, count;
+    if (!fin.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !fin.read(reinterpret_cast<char *>(&version), sizeof(version)) || version != VERSION ||
+        !fin.read(reinterpret_cast<char *>(&count), sizeof(count)))
+        return false;
+
+    // A corrupt count mustn't allocate more frames than the file can hold
+    std::streampos start = fin.tellg();
+    fin.seekg(0, std::ios::end);
+    std::streamoff remaining = fin.tellg() - start;
+    fin.seekg(start);
+    if (!fin || uint64_t(count) * FRAME_SIZE > uint64_t(remaining))
+        return false;
+
+    frames.resize(count);
+    for (CameraPathFrame &frame : frames)
+    {
+        float values[7];
+        if (!fin.read(reinterpret_cast<char *>(values), sizeof(values)) ||
+            !fin.read(reinterpret_cast<char *>(&frame.debugColors), sizeof(frame.debugColors)))
+        {
+            frames.clear();
+            return false;
+        }
+        frame.position = glm::vec3(values[0], values[1], values[2]);
+        frame.theta = values[3];
+        frame.phi = values[4];
+        frame.TPS = values[5];
+        frame.FPS = values[6];
+    }
+    return true;
+}
+
+int CameraPath::getFrameCount() const
+{
+    return frames.size();
+}
+
+const CameraPathFrame &CameraPath::getFrame(int frame) const
+{
+    return frames[frame];
+}
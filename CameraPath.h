@@ -0,0 +1,48 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Camera and settings of a recorded frame, what decides what it renders
+struct CameraPathFrame
+{
+    glm::vec3 position;
+    float theta;
+    float phi;
+    float TPS; // In effect, calibrated or set by hand
+    float FPS;
+    uint8_t debugColors;
+};
+
+// CameraPath is a recorded walk through the museum, one entry per frame, so
+// that it can be played back at a fixed timestep and give the same frames on
+// every build.
+//
+// File layout (host endianness): the magic "CPTH", a uint32_t version and a
+// uint32_t frame count, followed by 7 floats (position, theta, phi, TPS, FPS)
+// and 1 byte of flags (debug colors) per frame.
+
+const std::string CAMERA_PATH_FILENAME = "camera_path.bin";
+
+class CameraPath
+{
+
+public:
+    void clear();
+    void add(const CameraPathFrame &frame);
+
+    bool save(const std::string &filename) const;
+    bool load(const std::string &filename);
+
+    int getFrameCount() const;
+    const CameraPathFrame &getFrame(int frame) const;
+
+private:
+    std::vector<CameraPathFrame> frames;
+};
+
+#endif // CAMERAPATH_H
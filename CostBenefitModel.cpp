@@ -0,0 +1,100 @@
+#include "CostBenefitModel.h"
+
+#include <algorithm>
+#include <fstream>
+
+// Weight of the angle to the view direction in the projected size benefit,
+// statues at the center of the view are worth up to this much more than at its border
+constexpr float FOCUS_WEIGHT = 0.5f;
+
+// Microseconds per triangle, vertex and object until calibrated
+static const RenderCost DEFAULT_RENDER_COST = {1e-4f, 5e-5f, 0.01f};
+
+CostBenefitModel::CostBenefitModel()
+{
+    renderCost = DEFAULT_RENDER_COST;
+    benefitModel = BENEFIT_PROJECTED_SIZE;
+    viewpoint = glm::vec3(0.0f);
+    viewDirection = glm::vec3(0.0f, 0.0f, -1.0f);
+    focalLength = 1.0f;
+}
+
+bool CostBenefitModel::load(const std::string &filename)
+{
+    std::ifstream fin(filename);
+    RenderCost loaded;
+    if (!(fin >> loaded.triangle >> loaded.vertex >> loaded.object) || loaded.triangle <= 0.0f)
+        return false;
+    renderCost = loaded;
+    renderCost.vertex = std::max(0.0f, renderCost.vertex);
+    renderCost.object = std::max(0.0f, renderCost.object);
+    return true;
+}
+
+bool CostBenefitModel::save(const std::string &filename) const
+{
+    std::ofstream fout(filename);
+    if (!fout.is_open())
+        return false;
+    fout << renderCost.triangle << " " << renderCost.vertex << " " << renderCost.object << std::endl;
+    return bool(fout);
+}
+
+void CostBenefitModel::setRenderCost(const RenderCost &renderCost)
+{
+    this->renderCost = renderCost;
+}
+
+const RenderCost &CostBenefitModel::getRenderCost() const
+{
+    return renderCost;
+}
+
+float CostBenefitModel::getTrianglesPerSecond() const
+{
+    return 1e6f / renderCost.triangle;
+}
+
+void CostBenefitModel::setBenefitModel(BenefitModel model)
+{
+    benefitModel = model;
+}
+
+void CostBenefitModel::setView(const glm::mat4 &view, const glm::mat4 &projection)
+{
+    glm::mat4 cameraToWorld = glm::inverse(view);
+    viewpoint = glm::vec3(cameraToWorld[3]);
+    viewDirection = -glm::normalize(glm::vec3(cameraToWorld[2]));
+
+    // Half the screen height spans [-1, 1] in NDC
+    focalLength = 0.5f * projection[1][1];
+}
+
+void CostBenefitModel::getBenefits(const AABB &box, const LodInfo *lods, int nLods, float *benefit) const
+{
+    float size = screenSize(box);
+    for (int lod = 0; lod < nLods; ++lod)
+        benefit[lod] = size * (lods[0].error - lods[lod].error);
+}
+
+float CostBenefitModel::getCost(int nTriangles, int nVertices) const
+{
+    return nTriangles + (renderCost.vertex * nVertices + renderCost.object) / renderCost.triangle;
+}
+
+float CostBenefitModel::screenSize(const AABB &box) const
+{
+    glm::vec3 center = 0.5f * (box.min + box.max);
+    float diameter = glm::length(box.max - box.min);
+    glm::vec3 toCenter = center - viewpoint;
+    float distance = std::max(glm::length(toCenter), 1e-3f);
+
+    if (benefitModel == BENEFIT_DISTANCE)
+        return diameter / distance;
+
+    // Statues around the camera fill the screen at most
+    float depth = glm::dot(toCenter, viewDirection);
+    float size = std::min(1.0f, focalLength * diameter / std::max(depth, 0.5f * diameter));
+    float focus = 1.0f - FOCUS_WEIGHT + FOCUS_WEIGHT * std::max(0.0f, depth / distance);
+    return size * focus;
+}
@@ -0,0 +1,72 @@
+#ifndef COSTBENEFITMODEL_H
+#define COSTBENEFITMODEL_H
+
+#include "AABB.h"
+#include "LodMetadata.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+
+// How the benefit of rendering a statue with finer LODs is estimated
+enum BenefitModel
+{
+    BENEFIT_DISTANCE, // Size of the statue over its distance to the camera
+    BENEFIT_PROJECTED_SIZE, // Size of the statue on screen, through the projection, weighted by its angle to the view direction
+};
+
+// Rendering time of the parts of an object, in microseconds
+struct RenderCost
+{
+    float triangle;
+    float vertex;
+    float object; // Fixed cost of every object drawn, whatever its LOD
+};
+
+// CostBenefitModel gives the benefit and the cost of each LOD of an object, as
+// in Funkhouser and Sequin's time critical rendering. The benefit of a LOD is
+// how much it reduces the error of the coarsest one as seen from the camera:
+// the object space errors measured by MeshSimplifier, relative to the size of
+// the object, are projected to the screen with its size on screen. The cost is
+// the rendering time predicted from its triangles and vertices and a fixed cost
+// per object, with coefficients calibrated by CostCalibration. Costs are given
+// in triangle equivalents, the time of a triangle, so that budgets keep being
+// counted in triangles per second.
+
+class CostBenefitModel
+{
+
+public:
+    CostBenefitModel();
+
+    // Coefficients written by CostCalibration, the defaults are kept if they can't be read
+    bool load(const std::string &filename);
+    bool save(const std::string &filename) const;
+
+    void setRenderCost(const RenderCost &renderCost);
+    const RenderCost &getRenderCost() const;
+    float getTrianglesPerSecond() const;
+
+    void setBenefitModel(BenefitModel model);
+
+    // Camera of the frame the benefits are computed for
+    void setView(const glm::mat4 &view, const glm::mat4 &projection);
+
+    // Accumulated benefit of LODs 0 to nLods - 1 of an object with the world bounding box
+    void getBenefits(const AABB &box, const LodInfo *lods, int nLods, float *benefit) const;
+
+    // Of an object drawn with a LOD, in triangle equivalents
+    float getCost(int nTriangles, int nVertices) const;
+
+private:
+    float screenSize(const AABB &box) const;
+
+private:
+    RenderCost renderCost;
+    BenefitModel benefitModel;
+    glm::vec3 viewpoint;
+    glm::vec3 viewDirection;
+    float focalLength; // Scale from view space size over depth to screen heights
+};
+
+#endif // COSTBENEFITMODEL_H
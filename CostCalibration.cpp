@@ -0,0 +1,259 @@
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+#include "CostBenefitModel.h"
+#include "DrawList.h"
+#include "GeometryArena.h"
+#include "ShaderProgram.h"
+#include "TriangleMesh.h"
+#include "UniformBuffer.h"
+
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Calibrates the rendering cost model of the LOD selection. Batches of
+// instanced patches are drawn with different numbers of triangles, vertices
+// and instances, and the time until the GPU is done with each batch is fitted
+// with least squares to a cost per triangle, per vertex and per object plus a
+// constant. Indexed grids share most of their vertices and triangle soups
+// share none, which tells the vertex cost apart from the triangle cost. The
+// patches are small on screen so that the fragments don't dominate the time.
+
+// Grid of n x n quads over the unit square, its vertices shared or not
+void buildPatch(TriangleMesh &mesh, int n, bool shared)
+{
+    auto height = [](float x, float z) { return 0.1f * std::sin(6.0f * x) * std::cos(6.0f * z); };
+    auto corner = [&](int i, int j) { return glm::vec3(float(i) / n, height(float(i) / n, float(j) / n), float(j) / n); };
+    if (shared)
+    {
+        for (int j = 0; j <= n; ++j)
+            for (int i = 0; i <= n; ++i)
+                mesh.addVertex(corner(i, j));
+        for (int j = 0; j < n; ++j)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                int v = j * (n + 1) + i;
+                mesh.addTriangle(v, v + n + 1, v + 1);
+                mesh.addTriangle(v + 1, v + n + 1, v + n + 2);
+            }
+        }
+        return;
+    }
+    for (int j = 0; j < n; ++j)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            int v = mesh.vertices.size();
+            glm::vec3 corners[6] = {corner(i, j), corner(i, j + 1), corner(i + 1, j),
+                                    corner(i + 1, j), corner(i, j + 1), corner(i + 1, j + 1)};
+            for (const glm::vec3 &position : corners)
+                mesh.addVertex(position);
+            mesh.addTriangle(v, v + 1, v + 2);
+            mesh.addTriangle(v + 3, v + 4, v + 5);
+        }
+    }
+}
+
+struct Sample
+{
+    double triangles;
+    double vertices;
+    double objects;
+    double microseconds;
+};
+
+// Best time over all repetitions until the GPU is done with the batch
+double timeBatch(DrawList &drawList, GeometryArena &arena, const TriangleMesh &patch, int instances, int repetitions)
+{
+    using Clock = std::chrono::steady_clock;
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repetitions; ++r)
+    {
+        drawList.clear();
+        drawList.addDraw(patch);
+        for (int i = 0; i < instances; ++i)
+        {
+            // Tiny patches spread over the view
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(i % 64 - 32.0f, i / 64 % 64 - 32.0f, -60.0f - i / 4096));
+            drawList.addInstance(glm::scale(model, glm::vec3(0.2f)), glm::vec4(1.0f));
+        }
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glFinish();
+        Clock::time_point start = Clock::now();
+        drawList.submit(arena);
+        glFinish();
+        best = std::min(best, std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+// Least squares fit of the samples to the cost per triangle, vertex and object plus a constant
+bool fit(const std::vector<Sample> &samples, double coefficients[4])
+{
+    double normal[4][5] = {{0.0}};
+    for (const Sample &sample : samples)
+    {
+        double x[4] = {sample.triangles, sample.vertices, sample.objects, 1.0};
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int j = 0; j < 4; ++j)
+                normal[i][j] += x[i] * x[j];
+            normal[i][4] += x[i] * sample.microseconds;
+        }
+    }
+
+    // Gaussian elimination with partial pivoting
+    for (int col = 0; col < 4; ++col)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < 4; ++row)
+        {
+            if (std::abs(normal[row][col]) > std::abs(normal[pivot][col]))
+                pivot = row;
+        }
+        if (normal[pivot][col] == 0.0)
+            return false;
+        std::swap(normal[col], normal[pivot]);
+        for (int row = 0; row < 4; ++row)
+        {
+            if (row == col)
+                continue;
+            double factor = normal[row][col] / normal[col][col];
+            for (int k = col; k < 5; ++k)
+                normal[row][k] -= factor * normal[col][k];
+        }
+    }
+    for (int i = 0; i < 4; ++i)
+        coefficients[i] = normal[i][4] / normal[i][i];
+    return true;
+}
+
+const std::string DEFAULT_COST_MODEL = "cost_model.txt";
+const int DEFAULT_REPETITIONS = 5;
+
+int main(int argc, char **argv)
+{
+    std::string cost_model_filename = DEFAULT_COST_MODEL;
+    if (argc > 1)
+    {
+        cost_model_filename = std::string(argv[1]);
+    }
+
+    int repetitions = DEFAULT_REPETITIONS;
+    if (argc > 2)
+    {
+        repetitions = std::max(1, std::atoi(argv[2]));
+    }
+
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(64, 64);
+    glutCreateWindow(argv[0]);
+    glewExperimental = GL_TRUE;
+    glewInit();
+    glEnable(GL_DEPTH_TEST);
+
+    ShaderProgram program;
+    Shader vShader, fShader;
+    vShader.initFromFile(VERTEX_SHADER, "shaders/basic.vs");
+    fShader.initFromFile(FRAGMENT_SHADER, "shaders/basic.fs");
+    if (!vShader.isCompiled() || !fShader.isCompiled())
+    {
+        std::cerr << "Failed to build the shaders, run from the repository root" << std::endl;
+        return -1;
+    }
+    program.init();
+    program.addShader(vShader);
+    program.addShader(fShader);
+    program.link();
+    vShader.free();
+    fShader.free();
+    if (!program.isLinked())
+    {
+        std::cerr << program.log() << std::endl;
+        return -1;
+    }
+    program.bindUniformBlock("Frame", 0);
+    program.use();
+
+    UniformBuffer frameUniforms;
+    glm::mat4 frame[2] = {glm::mat4(1.0f), glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 200.0f)};
+    frameUniforms.init(0, sizeof(frame));
+    frameUniforms.update(frame, sizeof(frame));
+
+    GeometryArena arena;
+    arena.init();
+    DrawList drawList;
+    drawList.init();
+
+    // Patches from a few to thousands of triangles, each drawn from a few to thousands of times
+    const int sizes[] = {1, 4, 16, 48};
+    const int instanceCounts[] = {64, 512, 4096};
+    std::vector<TriangleMesh> patches;
+    for (bool shared : {true, false})
+    {
+        for (int n : sizes)
+        {
+            patches.emplace_back();
+            buildPatch(patches.back(), n, shared);
+            patches.back().sendToOpenGL(arena);
+        }
+    }
+
+    std::vector<Sample> samples;
+    for (TriangleMesh &patch : patches)
+    {
+        const ArenaRange &range = patch.getArenaRange();
+        for (int instances : instanceCounts)
+        {
+            double microseconds = timeBatch(drawList, arena, patch, instances, repetitions);
+            samples.push_back({double(range.nIndices / 3) * instances, double(range.nVertices) * instances, double(instances), microseconds});
+        }
+    }
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR)
+    {
+        std::cerr << "E: OpenGL error " << error << std::endl;
+        return -1;
+    }
+
+    double coefficients[4];
+    if (!fit(samples, coefficients) || coefficients[0] <= 0.0)
+    {
+        std::cerr << "Couldn't fit the rendering cost, the times don't grow with the triangles" << std::endl;
+        return -1;
+    }
+
+    CostBenefitModel model;
+    model.setRenderCost({float(coefficients[0]), float(std::max(0.0, coefficients[1])), float(std::max(0.0, coefficients[2]))});
+    std::cout << samples.size() << " batches, best of " << repetitions << std::endl;
+    std::cout << "\tTriangle: " << coefficients[0] * 1e3 << " ns (" << model.getTrianglesPerSecond() << " TPS)" << std::endl;
+    std::cout << "\tVertex:   " << coefficients[1] * 1e3 << " ns" << std::endl;
+    std::cout << "\tObject:   " << coefficients[2] * 1e3 << " ns" << std::endl;
+    std::cout << "\tBatch:    " << coefficients[3] << " us" << std::endl;
+    if (!model.save(cost_model_filename))
+    {
+        std::cerr << "Couldn't write " << cost_model_filename << std::endl;
+        return -1;
+    }
+    std::cout << "Saved to " << cost_model_filename << std::endl;
+
+    drawList.free();
+    frameUniforms.free();
+    for (TriangleMesh &patch : patches)
+        patch.free();
+    arena.free();
+    program.free();
+    return 0;
+}
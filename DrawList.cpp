@@ -0,0 +1,107 @@
+#include "DrawList.h"
+
+#include <algorithm>
+
+DrawList::DrawList()
+{
+    indirectBuffer = 0;
+    indirectCapacity = 0;
+}
+
+void DrawList::init()
+{
+    instances.init();
+    glGenBuffers(1, &indirectBuffer);
+}
+
+void DrawList::free()
+{
+    instances.free();
+    glDeleteBuffers(1, &indirectBuffer);
+    indirectBuffer = 0;
+    indirectCapacity = 0;
+}
+
+void DrawList::clear()
+{
+    commands.clear();
+    instances.clear();
+}
+
+void DrawList::addDraw(const TriangleMesh &mesh)
+{
+    // A previous draw without instances is replaced
+    if (!commands.empty() && commands.back().instanceCount == 0)
+        commands.pop_back();
+
+    const ArenaRange &range = mesh.getArenaRange();
+    DrawElementsIndirectCommand command;
+    command.count = range.nIndices;
+    command.instanceCount = 0;
+    command.firstIndex = range.firstIndex;
+    command.baseVertex = range.baseVertex;
+    command.baseInstance = instances.getCount();
+    if (command.count > 0)
+        commands.push_back(command);
+}
+
+void DrawList::addInstance(const glm::mat4 &model, const glm::vec4 &color)
+{
+    if (commands.empty())
+        return;
+    instances.add(model, color);
+    ++commands.back().instanceCount;
+}
+
+void DrawList::submit(const GeometryArena &arena)
+{
+    if (!commands.empty() && commands.back().instanceCount == 0)
+        commands.pop_back();
+    if (commands.empty())
+        return;
+
+    instances.upload();
+    arena.bind();
+
+    if (GLEW_ARB_multi_draw_indirect)
+    {
+        // baseInstance offsets the instance attributes, so they all point at the start of the buffer
+        instances.bind(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        if (commands.size() > indirectCapacity)
+            indirectCapacity = 2 * commands.size();
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, commands.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return;
+    }
+
+    if (GLEW_ARB_base_instance)
+        instances.bind(0);
+    for (const DrawElementsIndirectCommand &command : commands)
+    {
+        void *firstIndex = (void *)(command.firstIndex * sizeof(GLuint));
+        if (GLEW_ARB_base_instance)
+        {
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, firstIndex,
+                                                          command.instanceCount, command.baseVertex, command.baseInstance);
+        }
+        else
+        {
+            instances.bind(command.baseInstance);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, firstIndex,
+                                              command.instanceCount, command.baseVertex);
+        }
+    }
+}
+
+int DrawList::getCommandCount() const
+{
+    return commands.size();
+}
+
+int DrawList::getInstanceCount() const
+{
+    return instances.getCount();
+}
@@ -0,0 +1,57 @@
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include "GeometryArena.h"
+#include "InstanceBuffer.h"
+#include "TriangleMesh.h"
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Layout of an indirect draw read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// DrawList gathers the draws of a frame on the CPU, each one a mesh of the
+// geometry arena with a contiguous range of instances, and submits them all
+// with a single glMultiDrawElementsIndirect. Without multi draw indirect it
+// falls back to one instanced draw per command, still without rebinding any
+// vertex array.
+
+class DrawList
+{
+
+public:
+    DrawList();
+
+    void init();
+    void free();
+
+    void clear();
+
+    // Starts a draw of the mesh, its instances are the ones added until the next draw
+    void addDraw(const TriangleMesh &mesh);
+    void addInstance(const glm::mat4 &model, const glm::vec4 &color);
+
+    void submit(const GeometryArena &arena);
+
+    int getCommandCount() const;
+    int getInstanceCount() const;
+
+private:
+    std::vector<DrawElementsIndirectCommand> commands;
+    InstanceBuffer instances;
+    GLuint indirectBuffer;
+    size_t indirectCapacity; // Commands that fit in indirectBuffer
+};
+
+#endif // DRAWLIST_H
@@ -0,0 +1,221 @@
+#include "FramePlanner.h"
+
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+static float millisecondsSince(const Clock::time_point &start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+FramePlanner::FramePlanner()
+{
+    width = 0;
+    height = 0;
+    potentiallyVisible = 0;
+    drawnTriangles = 0;
+    drawnCost = 0.0f;
+    timings = {0.0f, 0.0f, 0.0f};
+}
+
+void FramePlanner::setModels(const std::vector<PlannerModel> &models)
+{
+    this->models = models;
+    firstBucket.assign(models.size() + 1, 0);
+    for (unsigned int model = 0; model < models.size(); ++model)
+        firstBucket[model + 1] = firstBucket[model] + models[model].lods.size();
+}
+
+void FramePlanner::setMuseum(int width, int height, const std::vector<MuseumStatue> &statues,
+                             const std::vector<std::vector<int>> &visibleSets, const std::vector<int> &setOfCell)
+{
+    this->width = width;
+    this->height = height;
+    this->statues = statues;
+    this->visibleSets = visibleSets;
+    this->setOfCell = setOfCell;
+    candidates.clear();
+}
+
+void FramePlanner::findCandidates(const glm::vec3 &viewpoint, const Frustum &frustum, bool useVisibility)
+{
+    Clock::time_point start = Clock::now();
+    candidates.clear();
+    boxes.clear();
+
+    // Only the statues inside the view frustum compete for the budget
+    const std::vector<int> *visible = nullptr;
+    if (useVisibility && width > 0 && height > 0)
+    {
+        glm::ivec2 cell = glm::clamp(glm::ivec2(viewpoint.x, viewpoint.z), glm::ivec2(0, 0), glm::ivec2(width - 1, height - 1));
+        int set = setOfCell[cell.x * height + cell.y];
+        if (set < 0)
+        {
+            potentiallyVisible = 0;
+            timings.candidates = millisecondsSince(start);
+            return;
+        }
+        visible = &visibleSets[set];
+        for (int statue : *visible)
+            boxes.add(getStatueAABB(statue));
+    }
+    else
+    {
+        for (unsigned int statue = 0; statue < statues.size(); ++statue)
+            boxes.add(getStatueAABB(statue));
+    }
+    potentiallyVisible = boxes.size();
+
+    inFrustum.clear();
+    frustum.intersects(boxes, inFrustum);
+    candidates.reserve(inFrustum.size());
+    for (int i : inFrustum)
+        candidates.push_back(visible ? (*visible)[i] : i);
+    timings.candidates = millisecondsSince(start);
+}
+
+int FramePlanner::cullCandidates(const std::function<bool(int)> &isHidden)
+{
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < candidates.size(); ++i)
+    {
+        if (!isHidden(candidates[i]))
+            candidates[kept++] = candidates[i];
+    }
+    int culled = candidates.size() - kept;
+    candidates.resize(kept);
+    return culled;
+}
+
+void FramePlanner::selectLods(const glm::mat4 &view, const glm::mat4 &projection, float budget,
+                              const std::function<bool(int, int)> &isAvailable)
+{
+    // Benefit and cost of the LODs of each candidate, up to the first one that can't be loaded
+    Clock::time_point start = Clock::now();
+    costBenefit.setView(view, projection);
+    selector.clear();
+    for (int statue : candidates)
+    {
+        const MuseumStatue &museumStatue = statues[statue];
+        const std::vector<LodInfo> &lods = models[museumStatue.model].lods;
+        int nLods = 1;
+        while (nLods < int(lods.size()) && isAvailable(museumStatue.model, nLods))
+            ++nLods;
+        benefit.resize(nLods);
+        cost.resize(nLods);
+        costBenefit.getBenefits(getStatueAABB(statue), lods.data(), nLods, benefit.data());
+        for (int lod = 0; lod < nLods; ++lod)
+            cost[lod] = costBenefit.getCost(lods[lod].triangles, lods[lod].vertices);
+        selector.add(statue, nLods, benefit.data(), cost.data());
+    }
+    selector.select(budget);
+    timings.selection = millisecondsSince(start);
+}
+
+void FramePlanner::buildDraws(const std::vector<int> &renderedLods)
+{
+    // Counting sort of the candidates by bucket, so that the instances of each draw are contiguous
+    Clock::time_point start = Clock::now();
+    bucketStart.assign(firstBucket.back() + 1, 0);
+    drawnTriangles = 0;
+    drawnCost = 0.0f;
+    for (unsigned int i = 0; i < candidates.size(); ++i)
+    {
+        int lod = renderedLods[i];
+        if (lod < 0)
+            continue;
+        int model = statues[candidates[i]].model;
+        const LodInfo &info = models[model].lods[lod];
+        ++bucketStart[firstBucket[model] + lod + 1];
+        drawnTriangles += info.triangles;
+        drawnCost += costBenefit.getCost(info.triangles, info.vertices);
+    }
+    for (unsigned int bucket = 1; bucket < bucketStart.size(); ++bucket)
+        bucketStart[bucket] += bucketStart[bucket - 1];
+
+    instances.resize(bucketStart.back());
+    draws.clear();
+    for (unsigned int model = 0; model < models.size(); ++model)
+    {
+        for (int bucket = firstBucket[model]; bucket < firstBucket[model + 1]; ++bucket)
+        {
+            if (bucketStart[bucket] != bucketStart[bucket + 1])
+                draws.push_back({int(model), bucket - firstBucket[model], bucketStart[bucket], bucketStart[bucket + 1] - bucketStart[bucket]});
+        }
+    }
+    for (unsigned int i = 0; i < candidates.size(); ++i)
+    {
+        if (renderedLods[i] >= 0)
+            instances[bucketStart[firstBucket[statues[candidates[i]].model] + renderedLods[i]]++] = candidates[i];
+    }
+    timings.draws = millisecondsSince(start);
+}
+
+const std::vector<int> &FramePlanner::getCandidates() const
+{
+    return candidates;
+}
+
+int FramePlanner::getPotentiallyVisibleCount() const
+{
+    return potentiallyVisible;
+}
+
+int FramePlanner::getSelectedLod(int candidate) const
+{
+    return selector.getLod(candidate);
+}
+
+const std::vector<PlannedDraw> &FramePlanner::getDraws() const
+{
+    return draws;
+}
+
+const std::vector<int> &FramePlanner::getInstances() const
+{
+    return instances;
+}
+
+int FramePlanner::getTriangleCount() const
+{
+    return drawnTriangles;
+}
+
+float FramePlanner::getCost() const
+{
+    return drawnCost;
+}
+
+const std::vector<MuseumStatue> &FramePlanner::getStatues() const
+{
+    return statues;
+}
+
+AABB FramePlanner::getStatueAABB(int statue) const
+{
+    const MuseumStatue &museumStatue = statues[statue];
+    const AABB &aabb = models[museumStatue.model].aabb;
+    glm::vec3 offset = cellOrigin(museumStatue.position);
+    return AABB(aabb.min + offset, aabb.max + offset);
+}
+
+const PlannerTimings &FramePlanner::getTimings() const
+{
+    return timings;
+}
+
+LodSelector &FramePlanner::getSelector()
+{
+    return selector;
+}
+
+CostBenefitModel &FramePlanner::getCostBenefit()
+{
+    return costBenefit;
+}
+
+glm::vec3 FramePlanner::cellOrigin(const glm::ivec2 &cell)
+{
+    return glm::vec3(cell.x + 0.5f, 0.5f, cell.y + 0.5f);
+}
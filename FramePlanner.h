@@ -0,0 +1,125 @@
+#ifndef FRAMEPLANNER_H
+#define FRAMEPLANNER_H
+
+#include "AABB.h"
+#include "CostBenefitModel.h"
+#include "Frustum.h"
+#include "LodMetadata.h"
+#include "LodSelector.h"
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+// Model as the planner sees it: its LODs and the bounding box of the coarsest one, in model space
+struct PlannerModel
+{
+    std::vector<LodInfo> lods;
+    AABB aabb;
+};
+
+struct MuseumStatue
+{
+    int model;
+    glm::ivec2 position; // Cell of the floor plan
+};
+
+// Candidates drawn with the same LOD of a model, as instances of a single draw
+struct PlannedDraw
+{
+    int model;
+    int lod;
+    int firstInstance; // In getInstances()
+    int nInstances;
+};
+
+// Time spent in each stage of the last frame, in milliseconds
+struct PlannerTimings
+{
+    float candidates; // Visibility lookup and frustum culling
+    float selection;
+    float draws;
+};
+
+// FramePlanner does the CPU side of a frame: finding the statues that can be
+// seen from the camera, selecting their LODs within the budget and grouping
+// them into draws. It only needs the metadata of the models (triangle
+// counts, errors and bounding boxes) and never touches OpenGL, so that it
+// can be benchmarked and profiled without a window. Scene feeds its plans to
+// the GPU, and can remove occluded candidates between the stages.
+
+class FramePlanner
+{
+
+public:
+    FramePlanner();
+
+    void setModels(const std::vector<PlannerModel> &models);
+
+    // Statues of a width x height floor plan and what can be seen from each cell. Cells that see
+    // the same statues may share their set: visibleSets[setOfCell[x * height + y]], -1 for none.
+    void setMuseum(int width, int height, const std::vector<MuseumStatue> &statues,
+                   const std::vector<std::vector<int>> &visibleSets, const std::vector<int> &setOfCell);
+
+    // Statues visible from the cell of the viewpoint, or every statue, that are inside the frustum
+    void findCandidates(const glm::vec3 &viewpoint, const Frustum &frustum, bool useVisibility);
+
+    // Removes the candidates that isHidden(statue) tells apart, returns how many
+    int cullCandidates(const std::function<bool(int)> &isHidden);
+
+    // LOD of each candidate, no finer than the first one that isAvailable(model, lod) rejects
+    void selectLods(const glm::mat4 &view, const glm::mat4 &projection, float budget,
+                    const std::function<bool(int, int)> &isAvailable);
+
+    // Groups the candidates by the LOD they are drawn with, renderedLods[i] of candidate i, negative to skip it
+    void buildDraws(const std::vector<int> &renderedLods);
+
+    const std::vector<int> &getCandidates() const; // Statue indices
+    int getPotentiallyVisibleCount() const; // Candidates before frustum culling
+    int getSelectedLod(int candidate) const;
+
+    const std::vector<PlannedDraw> &getDraws() const;
+    const std::vector<int> &getInstances() const; // Statue indices, in the order of the draws
+    int getTriangleCount() const; // Of the draws
+    float getCost() const;
+
+    const std::vector<MuseumStatue> &getStatues() const;
+    AABB getStatueAABB(int statue) const;
+    const PlannerTimings &getTimings() const;
+
+    LodSelector &getSelector();
+    CostBenefitModel &getCostBenefit();
+
+    // Where the model of a statue in the cell is placed in the world
+    static glm::vec3 cellOrigin(const glm::ivec2 &cell);
+
+private:
+    std::vector<PlannerModel> models;
+    std::vector<int> firstBucket; // Of each model, buckets are (model, lod) pairs
+    int width;
+    int height;
+    std::vector<MuseumStatue> statues;
+    std::vector<std::vector<int>> visibleSets;
+    std::vector<int> setOfCell;
+
+    BoxBatch boxes;
+    std::vector<int> inFrustum;
+    std::vector<int> candidates;
+    int potentiallyVisible;
+
+    LodSelector selector;
+    CostBenefitModel costBenefit;
+    std::vector<float> benefit;
+    std::vector<float> cost;
+
+    std::vector<int> bucketStart;
+    std::vector<PlannedDraw> draws;
+    std::vector<int> instances;
+    int drawnTriangles;
+    float drawnCost;
+
+    PlannerTimings timings;
+};
+
+#endif // FRAMEPLANNER_H
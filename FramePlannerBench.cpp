@@ -0,0 +1,144 @@
+#include "BenchCommon.h"
+#include "FramePlanner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Runs the CPU side of the museum viewer, without a window, over synthetic
+// museums: square rooms of ROOM_SIZE x ROOM_SIZE cells, each one seeing the
+// statues of the rooms around it, and a camera walking a circle through them
+// while it looks around. Reports the time of each stage of FramePlanner, with
+// the visibility sets and with frustum culling alone.
+
+const int ROOM_SIZE = 16;
+const int VISIBLE_ROOMS = 2; // Rooms seen in each direction
+const int CELLS_PER_STATUE = 4;
+const int N_MODELS = 8;
+const float DEFAULT_BUDGET = 2e6f; // Triangle equivalents
+
+const int DEFAULT_FRAMES = 2000;
+const int DEFAULT_STATUE_COUNTS[] = {10000, 30000, 100000};
+
+// Models of 4 to 6 LODs, the finest ones of 2k to 64k triangles
+std::vector<PlannerModel> syntheticModels()
+{
+    std::vector<PlannerModel> models(N_MODELS);
+    for (int i = 0; i < N_MODELS; ++i)
+    {
+        int nLods = 4 + i % 3;
+        for (int lod = 0; lod < nLods; ++lod)
+        {
+            int depth = DEFAULT_FINEST_DEPTH - (nLods - 1 - lod);
+            int triangles = (2048 << (i % 6)) >> (2 * (nLods - 1 - lod));
+            models[i].lods.push_back({std::max(triangles, 12), std::max(triangles / 2, 8), depth, LodMetadata::clusterError(depth)});
+        }
+        models[i].aabb = AABB(glm::vec3(-0.4f, -0.5f, -0.4f), glm::vec3(0.4f, 0.3f + 0.05f * i, 0.4f));
+    }
+    return models;
+}
+
+// Square museum with about nStatues statues, one visible set per room
+void syntheticMuseum(int nStatues, FramePlanner &planner, int &size)
+{
+    int nRooms = std::max(1, int(std::ceil(std::sqrt(float(nStatues) * CELLS_PER_STATUE) / ROOM_SIZE)));
+    size = nRooms * ROOM_SIZE;
+
+    std::mt19937 random(nStatues);
+    std::vector<int> cells(size * size);
+    for (int cell = 0; cell < size * size; ++cell)
+        cells[cell] = cell;
+    std::shuffle(cells.begin(), cells.end(), random);
+
+    std::vector<MuseumStatue> statues(nStatues);
+    std::vector<std::vector<int>> statuesOfRoom(nRooms * nRooms);
+    for (int i = 0; i < nStatues; ++i)
+    {
+        glm::ivec2 cell(cells[i] / size, cells[i] % size);
+        statues[i] = {int(random() % N_MODELS), cell};
+        statuesOfRoom[(cell.x / ROOM_SIZE) * nRooms + cell.y / ROOM_SIZE].push_back(i);
+    }
+
+    std::vector<std::vector<int>> visibleSets(nRooms * nRooms);
+    for (int x = 0; x < nRooms; ++x)
+    {
+        for (int y = 0; y < nRooms; ++y)
+        {
+            std::vector<int> &visible = visibleSets[x * nRooms + y];
+            for (int i = std::max(0, x - VISIBLE_ROOMS); i <= std::min(nRooms - 1, x + VISIBLE_ROOMS); ++i)
+                for (int j = std::max(0, y - VISIBLE_ROOMS); j <= std::min(nRooms - 1, y + VISIBLE_ROOMS); ++j)
+                    visible.insert(visible.end(), statuesOfRoom[i * nRooms + j].begin(), statuesOfRoom[i * nRooms + j].end());
+        }
+    }
+
+    std::vector<int> setOfCell(size * size);
+    for (int cell = 0; cell < size * size; ++cell)
+        setOfCell[cell] = (cell / size / ROOM_SIZE) * nRooms + (cell % size) / ROOM_SIZE;
+
+    planner.setMuseum(size, size, statues, visibleSets, setOfCell);
+}
+
+void runFrames(FramePlanner &planner, int size, int frames, bool useVisibility)
+{
+    glm::mat4 projection = benchProjection();
+    StageTimes candidates = {0.0, 0.0f}, selection = {0.0, 0.0f}, draws = {0.0, 0.0f}, total = {0.0, 0.0f};
+    double totalCandidates = 0.0, totalDraws = 0.0, totalTriangles = 0.0;
+    std::vector<int> lods;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        BenchCamera camera = walkCircle(frame, frames, size);
+        planner.findCandidates(camera.position, Frustum(projection * camera.view), useVisibility);
+        planner.selectLods(camera.view, projection, DEFAULT_BUDGET, [](int, int) { return true; });
+        lods.resize(planner.getCandidates().size());
+        for (unsigned int i = 0; i < lods.size(); ++i)
+            lods[i] = planner.getSelectedLod(i);
+        planner.buildDraws(lods);
+
+        const PlannerTimings &timings = planner.getTimings();
+        candidates.add(timings.candidates);
+        selection.add(timings.selection);
+        draws.add(timings.draws);
+        total.add(timings.candidates + timings.selection + timings.draws);
+        totalCandidates += planner.getCandidates().size();
+        totalDraws += planner.getDraws().size();
+        totalTriangles += planner.getTriangleCount();
+    }
+
+    std::cout << "\t" << (useVisibility ? "Visibility sets" : "Frustum only") << ": " << totalCandidates / frames << " candidates, "
+              << totalDraws / frames << " draws, " << totalTriangles / frames << " triangles per frame" << std::endl;
+    printStage("Candidates: ", candidates, frames);
+    printStage("Selection:  ", selection, frames);
+    printStage("Draws:      ", draws, frames);
+    printStage("Total:      ", total, frames);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<int> statueCounts(std::begin(DEFAULT_STATUE_COUNTS), std::end(DEFAULT_STATUE_COUNTS));
+    if (argc > 1)
+    {
+        statueCounts.assign(1, std::max(1, std::atoi(argv[1])));
+    }
+
+    int frames = DEFAULT_FRAMES;
+    if (argc > 2)
+    {
+        frames = std::max(1, std::atoi(argv[2]));
+    }
+
+    for (int nStatues : statueCounts)
+    {
+        FramePlanner planner;
+        planner.setModels(syntheticModels());
+        int size;
+        syntheticMuseum(nStatues, planner, size);
+
+        std::cout << nStatues << " statues in a " << size << " x " << size << " museum, " << frames << " frames" << std::endl;
+        runFrames(planner, size, frames, true);
+        runFrames(planner, size, frames, false);
+    }
+    return 0;
+}
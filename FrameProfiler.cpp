@@ -0,0 +1,188 @@
+#include "FrameProfiler.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <fstream>
+
+using Clock = std::chrono::steady_clock;
+
+static const char *TIMER_NAMES[N_FRAME_TIMERS] = {
+    "Frame", "Update", "Visibility", "LOD selection", "Walls", "Statues", "ImGui", "GPU scene", "GPU ImGui",
+};
+
+static const char *TIMER_COLUMNS[N_FRAME_TIMERS] = {
+    "frame_ms", "update_ms", "visibility_ms", "lod_selection_ms", "walls_ms", "statues_ms", "imgui_ms", "gpu_scene_ms", "gpu_imgui_ms",
+};
+
+static float millisecondsSince(const Clock::time_point &start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+FrameProfiler::FrameProfiler()
+{
+    times.assign(PROFILER_HISTORY * N_FRAME_TIMERS, -1.0f);
+    frame = -1;
+}
+
+void FrameProfiler::init()
+{
+    for (GpuTimer &gpuTimer : gpuTimers)
+        gpuTimer.init();
+}
+
+void FrameProfiler::free()
+{
+    for (GpuTimer &gpuTimer : gpuTimers)
+        gpuTimer.free();
+}
+
+void FrameProfiler::beginFrame()
+{
+    Clock::time_point now = Clock::now();
+    if (frame >= 0)
+        time(frame, TIMER_FRAME) = std::chrono::duration<float, std::milli>(now - frameStart).count();
+    ++frame;
+    frameStart = now;
+
+    // CPU stages that don't run take no time, GPU ones are unknown until measured
+    for (int timer = 0; timer < N_FRAME_TIMERS; ++timer)
+        time(frame, FrameTimer(timer)) = timer < FIRST_GPU_TIMER && timer != TIMER_FRAME ? 0.0f : -1.0f;
+
+    long long tag;
+    double milliseconds;
+    for (int timer = FIRST_MEASURED_GPU_TIMER; timer < N_FRAME_TIMERS; ++timer)
+    {
+        while (gpuTimers[timer - FIRST_MEASURED_GPU_TIMER].collect(tag, milliseconds))
+            addGpuTime(FrameTimer(timer), tag, milliseconds);
+    }
+}
+
+long long FrameProfiler::getFrame() const
+{
+    return frame;
+}
+
+void FrameProfiler::addTime(FrameTimer timer, float milliseconds)
+{
+    if (frame >= 0)
+        time(frame, timer) += milliseconds;
+}
+
+void FrameProfiler::addGpuTime(FrameTimer timer, long long frame, double milliseconds)
+{
+    // Measurements older than the history are lost
+    if (frame >= 0 && frame <= this->frame && this->frame - frame < PROFILER_HISTORY)
+        time(frame, timer) = milliseconds;
+}
+
+void FrameProfiler::beginGpu(FrameTimer timer)
+{
+    gpuTimers[timer - FIRST_MEASURED_GPU_TIMER].begin(frame);
+}
+
+void FrameProfiler::endGpu(FrameTimer timer)
+{
+    gpuTimers[timer - FIRST_MEASURED_GPU_TIMER].end();
+}
+
+void FrameProfiler::getStatistics(FrameTimer timer, TimerStatistics &statistics) const
+{
+    // Over the finished frames in the history, the current one is still being measured
+    sorted.clear();
+    for (long long f = std::max(0LL, frame - PROFILER_HISTORY + 1); f < frame; ++f)
+    {
+        float milliseconds = times[(f % PROFILER_HISTORY) * N_FRAME_TIMERS + timer];
+        if (milliseconds >= 0.0f)
+            sorted.push_back(milliseconds);
+    }
+    statistics = {int(sorted.size()), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    if (sorted.empty())
+        return;
+
+    double sum = 0.0;
+    for (float milliseconds : sorted)
+        sum += milliseconds;
+    statistics.average = sum / sorted.size();
+
+    // Percentiles by selection, from the lowest to the highest rank
+    int n = sorted.size();
+    std::nth_element(sorted.begin(), sorted.begin() + n * 95 / 100, sorted.end());
+    statistics.p95 = sorted[n * 95 / 100];
+    std::nth_element(sorted.begin() + n * 95 / 100, sorted.begin() + n * 99 / 100, sorted.end());
+    statistics.p99 = sorted[n * 99 / 100];
+    statistics.min = *std::min_element(sorted.begin(), sorted.begin() + n * 95 / 100 + 1);
+    statistics.max = *std::max_element(sorted.begin() + n * 99 / 100, sorted.end());
+}
+
+void FrameProfiler::renderStatistics()
+{
+    if (!ImGui::BeginTable("Frame timers", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit))
+        return;
+    const char *headers[6] = {"Stage (ms)", "min", "avg", "p95", "p99", "max"};
+    for (const char *header : headers)
+        ImGui::TableSetupColumn(header);
+    ImGui::TableHeadersRow();
+
+    TimerStatistics statistics;
+    for (int timer = 0; timer < N_FRAME_TIMERS; ++timer)
+    {
+        getStatistics(FrameTimer(timer), statistics);
+        if (statistics.samples == 0)
+            continue;
+        float values[5] = {statistics.min, statistics.average, statistics.p95, statistics.p99, statistics.max};
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(TIMER_NAMES[timer]);
+        for (float value : values)
+        {
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", value);
+        }
+    }
+    ImGui::EndTable();
+}
+
+bool FrameProfiler::dump(const std::string &filename, int nFrames) const
+{
+    std::ofstream fout(filename);
+    if (!fout.is_open())
+        return false;
+
+    fout << "frame";
+    for (const char *column : TIMER_COLUMNS)
+        fout << "," << column;
+    fout << "\n";
+
+    // GPU times that haven't come back yet are left empty
+    long long first = std::max({0LL, frame - nFrames, frame - PROFILER_HISTORY + 1});
+    for (long long f = first; f < frame; ++f)
+    {
+        fout << f;
+        for (int timer = 0; timer < N_FRAME_TIMERS; ++timer)
+        {
+            float milliseconds = times[(f % PROFILER_HISTORY) * N_FRAME_TIMERS + timer];
+            fout << ",";
+            if (milliseconds >= 0.0f)
+                fout << milliseconds;
+        }
+        fout << "\n";
+    }
+    return bool(fout);
+}
+
+float &FrameProfiler::time(long long frame, FrameTimer timer)
+{
+    return times[(frame % PROFILER_HISTORY) * N_FRAME_TIMERS + timer];
+}
+
+StageTimer::StageTimer(FrameProfiler &profiler, FrameTimer timer) : profiler(profiler), timer(timer)
+{
+    start = Clock::now();
+}
+
+StageTimer::~StageTimer()
+{
+    profiler.addTime(timer, millisecondsSince(start));
+}
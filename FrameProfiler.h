@@ -0,0 +1,102 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include "GpuTimer.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Frames whose times are kept
+constexpr int PROFILER_HISTORY = 1024;
+
+// What is timed in each frame, the GPU timers last
+enum FrameTimer
+{
+    TIMER_FRAME, // CPU time from the start of a frame to the start of the next one
+    TIMER_UPDATE,
+    TIMER_VISIBILITY, // Candidate statues, frustum and occlusion culling
+    TIMER_LOD_SELECTION, // Selection, LOD streaming requests and draw grouping
+    TIMER_WALLS,
+    TIMER_STATUES, // Recording and submitting the draws
+    TIMER_IMGUI,
+    TIMER_GPU_SCENE, // Measured by Scene, whose timer also feeds FrameTimeController
+    TIMER_GPU_IMGUI,
+    N_FRAME_TIMERS
+};
+
+constexpr int FIRST_GPU_TIMER = TIMER_GPU_SCENE;
+
+// GPU timers that the profiler measures itself with beginGpu and endGpu, the others are added with addGpuTime
+constexpr int FIRST_MEASURED_GPU_TIMER = TIMER_GPU_IMGUI;
+
+// Distribution of the times of a timer over the kept frames, in milliseconds
+struct TimerStatistics
+{
+    int samples;
+    float min;
+    float average;
+    float p95;
+    float p99;
+    float max;
+};
+
+// FrameProfiler keeps the CPU and GPU time of each stage of the last
+// PROFILER_HISTORY frames, so that single slow frames show up in the
+// percentiles instead of being averaged away. CPU times of a stage add up
+// within a frame. GPU times are measured elsewhere and added later, or with a
+// GpuTimer of the profiler for the measured GPU timers, and are only known
+// some frames after.
+
+class FrameProfiler
+{
+
+public:
+    FrameProfiler();
+
+    void init();
+    void free();
+
+    // Ends the previous frame and collects the GPU times that are available
+    void beginFrame();
+    long long getFrame() const;
+
+    void addTime(FrameTimer timer, float milliseconds);
+    void addGpuTime(FrameTimer timer, long long frame, double milliseconds);
+
+    // Measures the GPU time of the commands in between, measured GPU timers only and not nested
+    void beginGpu(FrameTimer timer);
+    void endGpu(FrameTimer timer);
+
+    void getStatistics(FrameTimer timer, TimerStatistics &statistics) const;
+    void renderStatistics(); // As an ImGui table
+
+    // The times of the last nFrames finished frames, as CSV
+    bool dump(const std::string &filename, int nFrames) const;
+
+private:
+    float &time(long long frame, FrameTimer timer);
+
+private:
+    std::vector<float> times; // PROFILER_HISTORY rows of N_FRAME_TIMERS, negative if not measured
+    long long frame;
+    std::chrono::steady_clock::time_point frameStart;
+    GpuTimer gpuTimers[N_FRAME_TIMERS - FIRST_MEASURED_GPU_TIMER];
+    mutable std::vector<float> sorted;
+};
+
+// StageTimer adds the CPU time of its scope to a timer of the profiler
+class StageTimer
+{
+
+public:
+    StageTimer(FrameProfiler &profiler, FrameTimer timer);
+    ~StageTimer();
+
+private:
+    FrameProfiler &profiler;
+    FrameTimer timer;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // FRAMEPROFILER_H
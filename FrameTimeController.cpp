@@ -0,0 +1,120 @@
+#include "FrameTimeController.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Weight of the previous frames in the fit, each frame
+constexpr float FORGETTING_FACTOR = 0.95f;
+
+// Uncertainty of the fit before any sample, also the most it can grow back to by forgetting
+constexpr float INITIAL_MS_PER_MEGATRIANGLE_VARIANCE = 1e4f;
+constexpr float INITIAL_MS_PER_KILODRAW_VARIANCE = 1e2f;
+constexpr float MAX_COVARIANCE_TRACE = INITIAL_MS_PER_MEGATRIANGLE_VARIANCE + INITIAL_MS_PER_KILODRAW_VARIANCE;
+
+// Largest change of the budget from one frame to the next
+constexpr float MAX_BUDGET_STEP = 1.25f;
+
+// Fastest a triangle can be drawn, so that the budget stays finite
+constexpr float MIN_MS_PER_MEGATRIANGLE = 1e-3f;
+
+FrameTimeController::FrameTimeController()
+{
+    reset(1e7f);
+}
+
+void FrameTimeController::reset(float trianglesPerSecond)
+{
+    msPerMegatriangle = 1e9f / std::max(trianglesPerSecond, 1.0f);
+    msPerKilodraw = 1.0f;
+    resetCovariance();
+    budget = 0.0f;
+    samples = 0;
+}
+
+void FrameTimeController::resetCovariance()
+{
+    covariance[0][0] = INITIAL_MS_PER_MEGATRIANGLE_VARIANCE;
+    covariance[0][1] = covariance[1][0] = 0.0f;
+    covariance[1][1] = INITIAL_MS_PER_KILODRAW_VARIANCE;
+}
+
+void FrameTimeController::addSample(float triangles, int draws, float milliseconds)
+{
+    if (!std::isfinite(triangles) || !std::isfinite(milliseconds))
+        return;
+
+    float x[2] = {triangles * 1e-6f, draws * 1e-3f};
+
+    // Gain of the new sample, from the uncertainty of the current fit along it
+    float px[2] = {covariance[0][0] * x[0] + covariance[0][1] * x[1],
+                   covariance[1][0] * x[0] + covariance[1][1] * x[1]};
+    float denominator = FORGETTING_FACTOR + x[0] * px[0] + x[1] * px[1];
+    float gain[2] = {px[0] / denominator, px[1] / denominator};
+
+    float error = milliseconds - (msPerMegatriangle * x[0] + msPerKilodraw * x[1]);
+    float newMsPerMegatriangle = std::max(MIN_MS_PER_MEGATRIANGLE, msPerMegatriangle + gain[0] * error);
+    float newMsPerKilodraw = std::max(0.0f, msPerKilodraw + gain[1] * error);
+
+    // A sample that breaks the fit is dropped, and the fit starts trusting new samples again
+    if (!std::isfinite(newMsPerMegatriangle) || !std::isfinite(newMsPerKilodraw))
+    {
+        resetCovariance();
+        return;
+    }
+    msPerMegatriangle = newMsPerMegatriangle;
+    msPerKilodraw = newMsPerKilodraw;
+
+    // P = (P - k x^T P) / lambda, where x^T P is px transposed as P is symmetric
+    for (int i = 0; i < 2; ++i)
+    {
+        for (int j = 0; j < 2; ++j)
+            covariance[i][j] = (covariance[i][j] - gain[i] * px[j]) / FORGETTING_FACTOR;
+    }
+
+    // With the same triangles and draws every frame, the directions they don't excite grow by 1 / lambda per
+    // frame; scaling the trace back keeps the covariance positive definite and the gains bounded
+    float trace = covariance[0][0] + covariance[1][1];
+    if (!std::isfinite(trace))
+        resetCovariance();
+    else if (trace > MAX_COVARIANCE_TRACE)
+    {
+        float scale = MAX_COVARIANCE_TRACE / trace;
+        for (int i = 0; i < 2; ++i)
+        {
+            for (int j = 0; j < 2; ++j)
+                covariance[i][j] *= scale;
+        }
+    }
+    ++samples;
+}
+
+float FrameTimeController::updateBudget(float targetMilliseconds, int draws)
+{
+    float available = std::max(0.0f, targetMilliseconds - msPerKilodraw * draws * 1e-3f);
+    float target = 1e6f * available / msPerMegatriangle;
+    if (budget <= 0.0f)
+        budget = target;
+    else
+        budget = std::min(std::max(target, budget / MAX_BUDGET_STEP), budget * MAX_BUDGET_STEP);
+    return budget;
+}
+
+float FrameTimeController::getBudget() const
+{
+    return budget;
+}
+
+float FrameTimeController::getTrianglesPerSecond() const
+{
+    return 1e9f / msPerMegatriangle;
+}
+
+float FrameTimeController::getDrawMicroseconds() const
+{
+    return msPerKilodraw;
+}
+
+int FrameTimeController::getSampleCount() const
+{
+    return samples;
+}
@@ -0,0 +1,45 @@
+#ifndef FRAMETIMECONTROLLER_H
+#define FRAMETIMECONTROLLER_H
+
+// FrameTimeController learns how long the GPU takes to render a frame from
+// the triangles and draws in it, and turns a target frame time into a
+// triangle budget. The time is modelled as a cost per triangle plus a cost
+// per draw, fitted to the measured frames with recursive least squares that
+// forget old frames, so that the model follows changes of the scene and of
+// the machine. The covariance of the fit is bounded, since forgetting inflates
+// it without limit while the frames don't change, and samples that would make
+// the model non-finite are rejected. The budget moves by a bounded factor per
+// frame to avoid oscillating while the model settles.
+
+class FrameTimeController
+{
+
+public:
+    FrameTimeController();
+
+    // Starts over from a guess of the triangles per second
+    void reset(float trianglesPerSecond);
+
+    void addSample(float triangles, int draws, float milliseconds);
+
+    // Triangles that can be drawn in the target time along with the draws, updated once per frame
+    float updateBudget(float targetMilliseconds, int draws);
+
+    float getBudget() const;
+    float getTrianglesPerSecond() const;
+    float getDrawMicroseconds() const;
+    int getSampleCount() const;
+
+private:
+    void resetCovariance();
+
+private:
+    // Milliseconds per million triangles and per thousand draws, so that both are of similar size
+    float msPerMegatriangle;
+    float msPerKilodraw;
+    float covariance[2][2];
+    float budget;
+    int samples;
+};
+
+#endif // FRAMETIMECONTROLLER_H
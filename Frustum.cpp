@@ -0,0 +1,126 @@
+#include "Frustum.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+void BoxBatch::clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+}
+
+void BoxBatch::add(const AABB &aabb)
+{
+    glm::vec3 center = 0.5f * (aabb.min + aabb.max);
+    glm::vec3 extent = 0.5f * (aabb.max - aabb.min);
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extent.x);
+    extentY.push_back(extent.y);
+    extentZ.push_back(extent.z);
+}
+
+size_t BoxBatch::size() const
+{
+    return centerX.size();
+}
+
+Frustum::Frustum()
+{
+    // Nothing is culled until it is built from a matrix
+    planes.fill(glm::vec4(0.0f));
+}
+
+Frustum::Frustum(const glm::mat4 &viewProjection)
+{
+    // Gribb and Hartmann: each plane is the last row of the matrix plus or minus another one
+    glm::mat4 rows = glm::transpose(viewProjection);
+    for (int i = 0; i < 3; ++i)
+    {
+        planes[2 * i] = rows[3] + rows[i];
+        planes[2 * i + 1] = rows[3] - rows[i];
+    }
+}
+
+bool Frustum::intersects(const AABB &aabb) const
+{
+    for (const glm::vec4 &plane : planes)
+    {
+        // The corner furthest along the normal of the plane
+        glm::vec3 corner = glm::mix(aabb.min, aabb.max, glm::greaterThan(glm::vec3(plane), glm::vec3(0.0f)));
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void Frustum::intersects(const BoxBatch &boxes, std::vector<int> &visible) const
+{
+    size_t i = 0;
+#ifdef __SSE__
+    // Plane coefficients and absolute values of the normals, broadcast to the 4 lanes
+    __m128 normal[6][3], absNormal[6][3], offset[6];
+    for (int p = 0; p < 6; ++p)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            normal[p][c] = _mm_set1_ps(planes[p][c]);
+            absNormal[p][c] = _mm_set1_ps(glm::abs(planes[p][c]));
+        }
+        offset[p] = _mm_set1_ps(planes[p].w);
+    }
+
+    for (; i + 4 <= boxes.size(); i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+        __m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+        __m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+        __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+        __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+        // A box is outside a plane when its center is further behind it than its projected radius
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 distance = _mm_add_ps(offset[p], _mm_add_ps(_mm_mul_ps(normal[p][0], cx),
+                              _mm_add_ps(_mm_mul_ps(normal[p][1], cy), _mm_mul_ps(normal[p][2], cz))));
+            __m128 radius = _mm_add_ps(_mm_mul_ps(absNormal[p][0], ex),
+                            _mm_add_ps(_mm_mul_ps(absNormal[p][1], ey), _mm_mul_ps(absNormal[p][2], ez)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            if (!(mask & (1 << lane)))
+                visible.push_back(i + lane);
+        }
+    }
+#endif
+
+    for (; i < boxes.size(); ++i)
+    {
+        glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+        glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+        if (intersects(center, extent))
+            visible.push_back(i);
+    }
+}
+
+bool Frustum::intersects(const glm::vec3 &center, const glm::vec3 &extent) const
+{
+    for (const glm::vec4 &plane : planes)
+    {
+        glm::vec3 normal(plane);
+        if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) < 0.0f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "AABB.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+
+// BoxBatch stores bounding boxes as separate arrays of centers and half
+// extents, so that they can be tested against a frustum four at a time.
+
+struct BoxBatch
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    void clear();
+    void add(const AABB &aabb);
+    size_t size() const;
+};
+
+// Frustum holds the 6 planes of a view frustum, extracted from a
+// projection * view matrix, and tests bounding boxes against them. Batches
+// of boxes are tested with SSE when it is available.
+
+class Frustum
+{
+
+public:
+    Frustum();
+    Frustum(const glm::mat4 &viewProjection);
+
+    // False only if the box is completely outside one of the planes
+    bool intersects(const AABB &aabb) const;
+
+    // Appends the index of every box of the batch that intersects the frustum
+    void intersects(const BoxBatch &boxes, std::vector<int> &visible) const;
+
+private:
+    bool intersects(const glm::vec3 &center, const glm::vec3 &extent) const;
+
+private:
+    std::array<glm::vec4, 6> planes; // Inside when dot(plane, (p, 1)) >= 0
+};
+
+#endif // FRUSTUM_H
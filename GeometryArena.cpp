@@ -0,0 +1,298 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <iterator>
+
+// Position and normal floats of a vertex
+constexpr size_t VERTEX_SIZE = 6 * sizeof(float);
+
+// Space reserved when the arena is created
+constexpr size_t INITIAL_VERTICES = 1 << 16;
+constexpr size_t INITIAL_INDICES = 3 << 16;
+
+// Free space kept at the end of the buffers when they shrink, so that the next LODs fit without growing
+constexpr size_t SHRINK_SLACK_DIVISOR = 4;
+
+FreeList::FreeList()
+{
+    capacity = 0;
+    freeSize = 0;
+}
+
+size_t FreeList::allocate(size_t size)
+{
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+    {
+        if (it->second < size)
+            continue;
+        size_t offset = it->first;
+        size_t remaining = it->second - size;
+        freeRanges.erase(it);
+        if (remaining > 0)
+            freeRanges[offset + size] = remaining;
+        freeSize -= size;
+        return offset;
+    }
+    return capacity;
+}
+
+void FreeList::release(size_t offset, size_t size)
+{
+    if (size == 0)
+        return;
+    freeSize += size;
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+    freeRanges[offset] = size;
+}
+
+void FreeList::grow(size_t newCapacity)
+{
+    size_t oldCapacity = capacity;
+    capacity = newCapacity;
+    release(oldCapacity, newCapacity - oldCapacity);
+}
+
+void FreeList::shrink(size_t newCapacity)
+{
+    if (newCapacity >= capacity || freeRanges.empty())
+        return;
+    auto last = std::prev(freeRanges.end());
+    size_t offset = last->first;
+    freeRanges.erase(last);
+    if (offset < newCapacity)
+        freeRanges[offset] = newCapacity - offset;
+    freeSize -= capacity - newCapacity;
+    capacity = newCapacity;
+}
+
+size_t FreeList::getCapacity() const
+{
+    return capacity;
+}
+
+size_t FreeList::getFreeSize() const
+{
+    return freeSize;
+}
+
+size_t FreeList::getUsedEnd() const
+{
+    if (freeRanges.empty())
+        return capacity;
+    auto last = std::prev(freeRanges.end());
+    return last->first + last->second == capacity ? last->first : capacity;
+}
+
+GeometryArena::GeometryArena()
+{
+    vao = 0;
+    vbo = 0;
+    ebo = 0;
+}
+
+void GeometryArena::init()
+{
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, INITIAL_VERTICES * VERTEX_SIZE, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, INITIAL_INDICES * sizeof(int), nullptr, GL_STATIC_DRAW);
+    setVertexFormat();
+
+    vertices = FreeList();
+    indices = FreeList();
+    vertices.grow(INITIAL_VERTICES);
+    indices.grow(INITIAL_INDICES);
+}
+
+void GeometryArena::free()
+{
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    glDeleteVertexArrays(1, &vao);
+    vao = vbo = ebo = 0;
+    vertices = FreeList();
+    indices = FreeList();
+}
+
+bool GeometryArena::add(const float *data, size_t nVertices, const int *indexData, size_t nIndices, ArenaRange &range)
+{
+    if (vao == 0)
+        return false;
+
+    range.nVertices = nVertices;
+    range.nIndices = nIndices;
+    range.baseVertex = vertices.allocate(nVertices);
+    if (range.baseVertex == vertices.getCapacity())
+    {
+        growVertices(nVertices);
+        range.baseVertex = vertices.allocate(nVertices);
+    }
+    range.firstIndex = indices.allocate(nIndices);
+    if (range.firstIndex == indices.getCapacity())
+    {
+        growIndices(nIndices);
+        range.firstIndex = indices.allocate(nIndices);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, range.baseVertex * VERTEX_SIZE, nVertices * VERTEX_SIZE, data);
+    glBindVertexArray(vao);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, range.firstIndex * sizeof(int), nIndices * sizeof(int), indexData);
+    return true;
+}
+
+void GeometryArena::remove(const ArenaRange &range)
+{
+    vertices.release(range.baseVertex, range.nVertices);
+    indices.release(range.firstIndex, range.nIndices);
+}
+
+void GeometryArena::relocate(ArenaRange &range)
+{
+    // Source and destination don't overlap, the destination was free
+    size_t baseVertex = vertices.allocate(range.nVertices);
+    if (baseVertex < range.baseVertex)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.baseVertex * VERTEX_SIZE, baseVertex * VERTEX_SIZE, range.nVertices * VERTEX_SIZE);
+        vertices.release(range.baseVertex, range.nVertices);
+        range.baseVertex = baseVertex;
+    }
+    else if (baseVertex != vertices.getCapacity())
+        vertices.release(baseVertex, range.nVertices);
+
+    // Indices are relative to the base vertex, so they don't change
+    size_t firstIndex = indices.allocate(range.nIndices);
+    if (firstIndex < range.firstIndex)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, ebo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.firstIndex * sizeof(int), firstIndex * sizeof(int), range.nIndices * sizeof(int));
+        indices.release(range.firstIndex, range.nIndices);
+        range.firstIndex = firstIndex;
+    }
+    else if (firstIndex != indices.getCapacity())
+        indices.release(firstIndex, range.nIndices);
+}
+
+void GeometryArena::shrink()
+{
+    // Never below the initial size, and only when at least half of the buffer goes
+    size_t usedVertices = vertices.getUsedEnd();
+    size_t vertexCapacity = std::max(INITIAL_VERTICES, usedVertices + usedVertices / SHRINK_SLACK_DIVISOR);
+    if (2 * vertexCapacity <= vertices.getCapacity())
+        resizeVertices(vertexCapacity);
+
+    size_t usedIndices = indices.getUsedEnd();
+    size_t indexCapacity = std::max(INITIAL_INDICES, usedIndices + usedIndices / SHRINK_SLACK_DIVISOR);
+    if (2 * indexCapacity <= indices.getCapacity())
+        resizeIndices(indexCapacity);
+}
+
+void GeometryArena::bind() const
+{
+    glBindVertexArray(vao);
+}
+
+size_t GeometryArena::getVertexCapacity() const
+{
+    return vertices.getCapacity();
+}
+
+size_t GeometryArena::getIndexCapacity() const
+{
+    return indices.getCapacity();
+}
+
+size_t GeometryArena::getCapacityBytes() const
+{
+    return vertices.getCapacity() * VERTEX_SIZE + indices.getCapacity() * sizeof(int);
+}
+
+size_t GeometryArena::getFreeBytes() const
+{
+    return vertices.getFreeSize() * VERTEX_SIZE + indices.getFreeSize() * sizeof(int);
+}
+
+// Moves the contents to a buffer at least twice as big, with room for n more vertices
+void GeometryArena::growVertices(size_t nVertices)
+{
+    size_t capacity = vertices.getCapacity();
+    resizeVertices(std::max(2 * capacity, capacity + nVertices));
+}
+
+void GeometryArena::growIndices(size_t nIndices)
+{
+    size_t capacity = indices.getCapacity();
+    resizeIndices(std::max(2 * capacity, capacity + nIndices));
+}
+
+// Copies the contents that fit to a new buffer of newCapacity vertices
+void GeometryArena::resizeVertices(size_t newCapacity)
+{
+    size_t capacity = vertices.getCapacity();
+    GLuint newVbo;
+    glGenBuffers(1, &newVbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newVbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * VERTEX_SIZE, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, std::min(capacity, newCapacity) * VERTEX_SIZE);
+    glDeleteBuffers(1, &vbo);
+    vbo = newVbo;
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    setVertexFormat();
+    if (newCapacity > capacity)
+        vertices.grow(newCapacity);
+    else
+        vertices.shrink(newCapacity);
+}
+
+void GeometryArena::resizeIndices(size_t newCapacity)
+{
+    size_t capacity = indices.getCapacity();
+    GLuint newEbo;
+    glGenBuffers(1, &newEbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newEbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * sizeof(int), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, ebo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, std::min(capacity, newCapacity) * sizeof(int));
+    glDeleteBuffers(1, &ebo);
+    ebo = newEbo;
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    if (newCapacity > capacity)
+        indices.grow(newCapacity);
+    else
+        indices.shrink(newCapacity);
+}
+
+// Points the vertex attributes of the vertex array at the bound vertex buffer
+void GeometryArena::setVertexFormat()
+{
+    glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, VERTEX_SIZE, (void *)0);
+    glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, VERTEX_SIZE, (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(POSITION_LOCATION);
+    glEnableVertexAttribArray(NORMAL_LOCATION);
+}
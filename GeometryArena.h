@@ -0,0 +1,94 @@
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <cstddef>
+#include <map>
+
+// Attribute locations of the vertex data, as declared in shaders/basic.vs
+constexpr GLuint POSITION_LOCATION = 0;
+constexpr GLuint NORMAL_LOCATION = 1;
+
+// Part of the arena taken by a mesh
+struct ArenaRange
+{
+    size_t baseVertex;
+    size_t nVertices;
+    size_t firstIndex;
+    size_t nIndices;
+};
+
+// FreeList hands out ranges of [0, capacity) with first fit, and merges
+// released ranges with their free neighbours.
+class FreeList
+{
+
+public:
+    FreeList();
+
+    // Returns capacity if no free range is big enough
+    size_t allocate(size_t size);
+    void release(size_t offset, size_t size);
+    void grow(size_t newCapacity);
+    void shrink(size_t newCapacity); // [newCapacity, capacity) has to be free
+    size_t getCapacity() const;
+    size_t getFreeSize() const;
+    size_t getUsedEnd() const; // End of the last allocated range
+
+private:
+    std::map<size_t, size_t> freeRanges; // offset -> size
+    size_t capacity;
+    size_t freeSize;
+};
+
+// GeometryArena stores the vertices and indices of every mesh in one vertex
+// buffer and one index buffer, behind a single vertex array. Meshes are drawn
+// with their base vertex and first index, so that switching between them
+// doesn't need any binding. The buffers grow when they run out of space, and
+// shrink when their owners move their meshes down into the free space left
+// by removed ones.
+
+class GeometryArena
+{
+
+public:
+    GeometryArena();
+
+    void init();
+    void free();
+
+    // data holds position and normal of every vertex, indices are relative to the first vertex
+    bool add(const float *data, size_t nVertices, const int *indices, size_t nIndices, ArenaRange &range);
+    void remove(const ArenaRange &range);
+
+    // Moves the range to the lowest free space that holds it, if that is below it
+    void relocate(ArenaRange &range);
+
+    // Gives back the free space at the end of the buffers, once it is worth a copy
+    void shrink();
+
+    void bind() const;
+
+    size_t getVertexCapacity() const;
+    size_t getIndexCapacity() const;
+    size_t getCapacityBytes() const;
+    size_t getFreeBytes() const;
+
+private:
+    void growVertices(size_t nVertices);
+    void growIndices(size_t nIndices);
+    void resizeVertices(size_t newCapacity);
+    void resizeIndices(size_t newCapacity);
+    void setVertexFormat();
+
+private:
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;
+    FreeList vertices;
+    FreeList indices;
+};
+
+#endif // GEOMETRYARENA_H
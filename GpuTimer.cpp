@@ -0,0 +1,80 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer()
+{
+    next = 0;
+    active = -1;
+}
+
+void GpuTimer::init()
+{
+    free();
+    if (!isSupported())
+        return;
+    queries.resize(GPU_TIMER_LATENCY);
+    for (Query &query : queries)
+    {
+        glGenQueries(1, &query.id);
+        query.tag = -1;
+        query.pending = false;
+    }
+}
+
+void GpuTimer::free()
+{
+    for (Query &query : queries)
+        glDeleteQueries(1, &query.id);
+    queries.clear();
+    next = 0;
+    active = -1;
+}
+
+bool GpuTimer::begin(long long tag)
+{
+    // The oldest query is reused only once its result has been collected
+    if (queries.empty() || queries[next].pending || active >= 0)
+        return false;
+    active = next;
+    queries[active].tag = tag;
+    glBeginQuery(GL_TIME_ELAPSED, queries[active].id);
+    return true;
+}
+
+void GpuTimer::end()
+{
+    if (active < 0)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    queries[active].pending = true;
+    next = (active + 1) % queries.size();
+    active = -1;
+}
+
+bool GpuTimer::collect(long long &tag, double &milliseconds)
+{
+    // Queries finish in order, so the oldest pending one is the first to check
+    for (unsigned int i = 0; i < queries.size(); ++i)
+    {
+        Query &query = queries[(next + i) % queries.size()];
+        if (!query.pending)
+            continue;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &nanoseconds);
+        query.pending = false;
+        tag = query.tag;
+        milliseconds = nanoseconds * 1e-6;
+        return true;
+    }
+    return false;
+}
+
+bool GpuTimer::isSupported() const
+{
+    return GLEW_ARB_timer_query;
+}
@@ -0,0 +1,49 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <vector>
+
+// Frames a measurement may take to come back before its query is reused
+constexpr int GPU_TIMER_LATENCY = 4;
+
+// GpuTimer measures the GPU time of a range of commands with GL_TIME_ELAPSED
+// queries. Each measurement uses its own query, taken from a small ring, and
+// its result is read frames later once it is available, so the CPU never
+// waits for the GPU. Measurements are skipped when every query is still in
+// flight, or when timer queries aren't supported.
+
+class GpuTimer
+{
+
+public:
+    GpuTimer();
+
+    void init();
+    void free();
+
+    // tag identifies the measurement when its result is collected, false if it is skipped
+    bool begin(long long tag);
+    void end();
+
+    // Oldest finished measurement not collected yet, in milliseconds
+    bool collect(long long &tag, double &milliseconds);
+
+    bool isSupported() const;
+
+private:
+    struct Query
+    {
+        GLuint id;
+        long long tag;
+        bool pending;
+    };
+
+    std::vector<Query> queries;
+    int next; // Oldest query, the next one to be used
+    int active; // Query between begin and end, -1 if none
+};
+
+#endif // GPUTIMER_H
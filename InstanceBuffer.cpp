@@ -0,0 +1,65 @@
+#include "InstanceBuffer.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstddef>
+
+InstanceBuffer::InstanceBuffer()
+{
+    vbo = 0;
+    capacity = 0;
+}
+
+void InstanceBuffer::init()
+{
+    glGenBuffers(1, &vbo);
+}
+
+void InstanceBuffer::free()
+{
+    glDeleteBuffers(1, &vbo);
+    vbo = 0;
+    capacity = 0;
+}
+
+void InstanceBuffer::clear()
+{
+    instances.clear();
+}
+
+void InstanceBuffer::add(const glm::mat4 &model, const glm::vec4 &color)
+{
+    instances.push_back({model, color});
+}
+
+int InstanceBuffer::getCount() const
+{
+    return instances.size();
+}
+
+void InstanceBuffer::upload()
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (instances.size() > capacity)
+        capacity = 2 * instances.size();
+
+    // Orphan the previous storage, so that a draw still reading it doesn't stall the upload
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), instances.data());
+}
+
+void InstanceBuffer::bind(int first) const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    size_t offset = first * sizeof(InstanceData);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        GLuint location = INSTANCE_MODEL_LOCATION + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)(offset + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+    glVertexAttribPointer(INSTANCE_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)(offset + offsetof(InstanceData, color)));
+    glVertexAttribDivisor(INSTANCE_COLOR_LOCATION, 1);
+    glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+}
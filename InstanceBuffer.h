@@ -0,0 +1,49 @@
+#ifndef INSTANCEBUFFER_H
+#define INSTANCEBUFFER_H
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Attribute locations of the per-instance data, as declared in shaders/basic.vs
+constexpr GLuint INSTANCE_MODEL_LOCATION = 2; // Takes 4 locations, one per column
+constexpr GLuint INSTANCE_COLOR_LOCATION = 6;
+
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// InstanceBuffer gathers the per-instance data of a frame on the CPU and
+// streams it to a single OpenGL buffer. Instanced draws read a contiguous
+// range of it, so that every instance of a mesh is drawn with one call.
+
+class InstanceBuffer
+{
+
+public:
+    InstanceBuffer();
+
+    void init();
+    void free();
+
+    void clear();
+    void add(const glm::mat4 &model, const glm::vec4 &color);
+    int getCount() const;
+
+    // Sends the instances added since clear to OpenGL
+    void upload();
+
+    // Points the instance attributes of the bound vertex array at the instances starting at first
+    void bind(int first) const;
+
+private:
+    std::vector<InstanceData> instances;
+    GLuint vbo;
+    size_t capacity; // Instances that fit in vbo
+};
+
+#endif // INSTANCEBUFFER_H
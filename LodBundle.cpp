@@ -0,0 +1,155 @@
+#include "LodBundle.h"
+
+#include <cstring>
+#include <fstream>
+
+static_assert(sizeof(LodBundleHeader) == 16, "Unexpected padding in LodBundleHeader");
+static_assert(sizeof(LodBundleEntry) == 40, "Unexpected padding in LodBundleEntry");
+
+constexpr char MAGIC[4] = {'L', 'O', 'D', 'B'};
+constexpr uint32_t VERSION = 2;
+constexpr size_t ALIGNMENT = 16;
+
+// Position and normal of a vertex
+constexpr size_t BYTES_PER_VERTEX = 6 * sizeof(float);
+
+// Indices of the 3 vertices of a triangle
+constexpr size_t BYTES_PER_TRIANGLE = 3 * sizeof(int);
+
+static size_t align(size_t offset)
+{
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// Offset of the indices from the start of the vertex data
+static size_t indicesOffset(const LodBundleEntry &entry)
+{
+    return align(entry.vertexCount * BYTES_PER_VERTEX);
+}
+
+LodBundle::LodBundle()
+{
+    header = nullptr;
+    entries = nullptr;
+}
+
+bool LodBundle::write(const std::string &filename, const std::vector<TriangleMesh> &lods)
+{
+    std::ofstream fout(filename, std::ios_base::out | std::ios_base::binary);
+    if (!fout.is_open())
+        return false;
+
+    LodBundleHeader bundleHeader = {};
+    memcpy(bundleHeader.magic, MAGIC, sizeof(MAGIC));
+    bundleHeader.version = VERSION;
+    bundleHeader.lodCount = lods.size();
+
+    // The data of every LOD is built first, since its vertex count is only known after dropping unused vertices
+    std::vector<std::vector<float>> data(lods.size());
+    std::vector<std::vector<int>> indices(lods.size());
+    std::vector<LodBundleEntry> bundleEntries(lods.size());
+    size_t offset = align(sizeof(LodBundleHeader) + lods.size() * sizeof(LodBundleEntry));
+    for (unsigned int i = 0; i < lods.size(); ++i)
+    {
+        lods[i].buildIndexedData(data[i], indices[i]);
+        bundleEntries[i].offset = offset;
+        bundleEntries[i].triangleCount = indices[i].size() / 3;
+        bundleEntries[i].vertexCount = data[i].size() / 6;
+        bundleEntries[i].aabb = lods[i].aabb;
+        offset = align(offset + indicesOffset(bundleEntries[i]) + bundleEntries[i].triangleCount * BYTES_PER_TRIANGLE);
+    }
+
+    fout.write(reinterpret_cast<const char *>(&bundleHeader), sizeof(LodBundleHeader));
+    fout.write(reinterpret_cast<const char *>(bundleEntries.data()), bundleEntries.size() * sizeof(LodBundleEntry));
+
+    const char zeros[ALIGNMENT] = {};
+    for (unsigned int i = 0; i < lods.size(); ++i)
+    {
+        fout.write(zeros, bundleEntries[i].offset - fout.tellp());
+        fout.write(reinterpret_cast<const char *>(data[i].data()), data[i].size() * sizeof(float));
+        fout.write(zeros, bundleEntries[i].offset + indicesOffset(bundleEntries[i]) - fout.tellp());
+        fout.write(reinterpret_cast<const char *>(indices[i].data()), indices[i].size() * sizeof(int));
+    }
+
+    return fout.good();
+}
+
+bool LodBundle::open(const std::string &filename)
+{
+    close();
+    if (!file.open(filename))
+        return false;
+
+    // Validate the layout before handing out any pointer into the mapping
+    size_t size = file.size();
+    header = reinterpret_cast<const LodBundleHeader *>(file.data());
+    bool valid = size >= sizeof(LodBundleHeader) &&
+                 memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header->version == VERSION &&
+                 sizeof(LodBundleHeader) + size_t(header->lodCount) * sizeof(LodBundleEntry) <= size;
+    if (valid)
+    {
+        entries = reinterpret_cast<const LodBundleEntry *>(file.data() + sizeof(LodBundleHeader));
+        for (unsigned int i = 0; i < header->lodCount && valid; ++i)
+        {
+            const LodBundleEntry &entry = entries[i];
+            valid = entry.offset % ALIGNMENT == 0 &&
+                    entry.offset <= size &&
+                    indicesOffset(entry) + entry.triangleCount * BYTES_PER_TRIANGLE <= size - entry.offset;
+        }
+    }
+
+    if (!valid)
+        close();
+    return valid;
+}
+
+void LodBundle::close()
+{
+    file.close();
+    header = nullptr;
+    entries = nullptr;
+}
+
+int LodBundle::getLodCount() const
+{
+    return header ? header->lodCount : 0;
+}
+
+int LodBundle::getTriangleCount(int lod) const
+{
+    return entries[lod].triangleCount;
+}
+
+int LodBundle::getVertexCount(int lod) const
+{
+    return entries[lod].vertexCount;
+}
+
+const AABB &LodBundle::getAABB(int lod) const
+{
+    return entries[lod].aabb;
+}
+
+const float *LodBundle::getVertexData(int lod) const
+{
+    return reinterpret_cast<const float *>(file.data() + entries[lod].offset);
+}
+
+const int *LodBundle::getIndices(int lod) const
+{
+    return reinterpret_cast<const int *>(file.data() + entries[lod].offset + indicesOffset(entries[lod]));
+}
+
+bool LodBundle::checkIndices(int lod) const
+{
+    const int *indices = getIndices(lod);
+    size_t n = 3 * size_t(entries[lod].triangleCount);
+    int nVertices = entries[lod].vertexCount;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (indices[i] < 0 || indices[i] >= nVertices)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef LODBUNDLE_H
+#define LODBUNDLE_H
+
+#include "AABB.h"
+#include "MappedFile.h"
+#include "TriangleMesh.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A LOD bundle stores every LOD of a model ready to be uploaded to OpenGL, so
+// that it can be mapped and sent to the GPU without any parsing at startup.
+//
+// File layout (host endianness, blocks aligned to 16 bytes):
+//   LodBundleHeader
+//   LodBundleEntry[lodCount], sorted in increasing level of detail
+//   For each LOD, the interleaved position and normal floats of its vertices
+//   followed by its vertex cache optimized indices, 3 ints per triangle
+
+const std::string LOD_BUNDLE_FILENAME = "lods.bin";
+
+struct LodBundleHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t lodCount;
+    uint32_t padding;
+};
+
+struct LodBundleEntry
+{
+    uint64_t offset; // Offset of the vertex data from the start of the file
+    uint32_t triangleCount;
+    uint32_t vertexCount;
+    AABB aabb;
+};
+
+class LodBundle
+{
+
+public:
+    LodBundle();
+
+    // lods has to be sorted in increasing level of detail and already rescaled
+    static bool write(const std::string &filename, const std::vector<TriangleMesh> &lods);
+
+    bool open(const std::string &filename);
+    void close();
+
+    int getLodCount() const;
+    int getTriangleCount(int lod) const;
+    int getVertexCount(int lod) const;
+    const AABB &getAABB(int lod) const;
+    const float *getVertexData(int lod) const;
+    const int *getIndices(int lod) const;
+
+    // Whether the indices of the LOD only refer to its vertices, they aren't checked when opening
+    bool checkIndices(int lod) const;
+
+private:
+    MappedFile file;
+    const LodBundleHeader *header;
+    const LodBundleEntry *entries;
+};
+
+#endif // LODBUNDLE_H
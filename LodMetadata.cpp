@@ -0,0 +1,46 @@
+#include "LodMetadata.h"
+
+#include <cmath>
+#include <fstream>
+
+bool LodMetadata::write(const std::string &filename, const std::vector<LodInfo> &lods)
+{
+    std::ofstream fout(filename);
+    if (!fout.is_open())
+        return false;
+    fout << "lods " << lods.size() << std::endl;
+    for (const LodInfo &lod : lods)
+        fout << lod.triangles << " " << lod.vertices << " " << lod.depth << " " << lod.error << std::endl;
+    return bool(fout);
+}
+
+bool LodMetadata::read(const std::string &filename, std::vector<LodInfo> &lods)
+{
+    std::ifstream fin(filename);
+    std::string keyword;
+    int n;
+    if (!(fin >> keyword >> n) || keyword != "lods" || n < 1)
+        return false;
+
+    // The count isn't trusted to size anything, a truncated or corrupt file runs out of lines first
+    lods.clear();
+    LodInfo lod;
+    while (int(lods.size()) < n && fin >> lod.triangles >> lod.vertices >> lod.depth >> lod.error)
+    {
+        if (lod.triangles < 0 || lod.vertices < 0)
+            break;
+        lods.push_back(lod);
+    }
+    if (int(lods.size()) < n)
+    {
+        lods.clear();
+        return false;
+    }
+    return true;
+}
+
+float LodMetadata::clusterError(int depth)
+{
+    // Vertices move at most the diagonal of a cell, relative to the diagonal of the box
+    return std::pow(2.0f, -float(depth));
+}
@@ -0,0 +1,42 @@
+#ifndef LODMETADATA_H
+#define LODMETADATA_H
+
+#include <string>
+#include <vector>
+
+// Describes every LOD of a model, so that the LODs can be planned with before
+// they are loaded. MeshSimplifier writes it next to the *.ply files.
+//
+// File layout (text):
+//   lods <count>
+//   <triangles> <vertices> <octree depth> <error>, one line per LOD in increasing level of detail
+//
+// The error is the distance between the LOD and the original mesh measured by
+// MeshSimplifier, relative to the diagonal of the bounding box of the model.
+
+const std::string LOD_METADATA_FILENAME = "lods.txt";
+
+// Octree depth of the finest LOD of models without metadata, the default of MeshSimplifier
+constexpr int DEFAULT_FINEST_DEPTH = 8;
+
+struct LodInfo
+{
+    int triangles;
+    int vertices;
+    int depth; // Of the octree cells whose vertices were clustered
+    float error;
+};
+
+class LodMetadata
+{
+
+public:
+    static bool write(const std::string &filename, const std::vector<LodInfo> &lods);
+    // False when the file is missing or malformed, lods is then empty
+    static bool read(const std::string &filename, std::vector<LodInfo> &lods);
+
+    // Bound of the error of clustering the vertices in cells of an octree of this depth
+    static float clusterError(int depth);
+};
+
+#endif // LODMETADATA_H
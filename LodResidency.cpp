@@ -0,0 +1,283 @@
+#include "LodResidency.h"
+#include "LodBundle.h"
+#include "LodMetadata.h"
+#include "PLYReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Default memory budget for the buffers of the LODs
+constexpr size_t DEFAULT_BUDGET = size_t(256) << 20;
+
+// Fraction of the arena that has to be free before the resident LODs are packed and the arena shrinks
+constexpr float COMPACTION_THRESHOLD = 0.5f;
+
+// Bytes taken by the buffers of a LOD: position and normal per vertex, 3 indices per triangle
+static size_t bufferSize(int nVertices, int nTriangles)
+{
+    return size_t(nVertices) * 6 * sizeof(float) + size_t(nTriangles) * 3 * sizeof(int);
+}
+
+std::string LodResidency::lodFilename(int model, int lod) const
+{
+    return directories[model] + "/" + std::to_string(lod) + ".ply";
+}
+
+LodResidency::LodResidency()
+{
+    models = nullptr;
+    arena = nullptr;
+    budget = DEFAULT_BUDGET;
+    residentBytes = 0;
+    loadingBytes = 0;
+    frame = 0;
+    evicted = false;
+}
+
+void LodResidency::init(std::vector<MeshLods> &models, const std::vector<std::string> &directories, GeometryArena &arena)
+{
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    this->models = &models;
+    this->directories = directories;
+    this->arena = &arena;
+    int n = directories.size();
+    entries.assign(n, std::vector<Entry>());
+
+    // The LODs and their triangle counts come from the metadata, the bundle or the *.ply headers, so the
+    // selector can plan with LODs that aren't loaded
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        std::vector<LodInfo> &info = models[i].info;
+        LodBundle bundle;
+        bool hasBundle = bundle.open(directories[i] + "/" + LOD_BUNDLE_FILENAME);
+        bool hasMetadata = LodMetadata::read(directories[i] + "/" + LOD_METADATA_FILENAME, info);
+        if (!hasMetadata)
+        {
+            // Exact for triangle meshes, like the ones MeshSimplifier writes
+            info.clear();
+            PLYHeader header;
+            if (hasBundle)
+            {
+                for (int lod = 0; lod < bundle.getLodCount(); ++lod)
+                    info.push_back({bundle.getTriangleCount(lod), bundle.getVertexCount(lod), 0, 0.0f});
+            }
+            else
+            {
+                for (int lod = 0; PLYReader::readHeader(lodFilename(i, lod), header); ++lod)
+                    info.push_back({header.nFaces, header.nVertices, 0, 0.0f});
+            }
+
+            // Written by an older MeshSimplifier, with its default depth
+            for (unsigned int lod = 0; lod < info.size(); ++lod)
+            {
+                info[lod].depth = DEFAULT_FINEST_DEPTH - int(info.size() - 1 - lod);
+                info[lod].error = LodMetadata::clusterError(info[lod].depth);
+            }
+        }
+
+        // A model without any LOD keeps a failed one, which is never drawn
+        entries[i].resize(std::max<size_t>(info.size(), 1));
+        info.resize(entries[i].size(), {0, 0, 0, 0.0f});
+        models[i].lods.resize(entries[i].size());
+        for (unsigned int lod = 0; lod < entries[i].size(); ++lod)
+        {
+            Entry &entry = entries[i][lod];
+            entry.state = info[lod].triangles > 0 ? NOT_RESIDENT : FAILED;
+            entry.lastUsed = 0;
+            entry.bytes = bufferSize(info[lod].vertices, info[lod].triangles);
+        }
+    }
+
+    // Only the coarsest LODs are loaded before the first frame
+    for (int i = 0; i < n; ++i)
+        request(i, 0);
+
+    std::vector<double> readTime(n, 0.0), uploadTime(n, 0.0), readyTime(n, 0.0);
+    LoadedLod loaded;
+    while (loader.wait(loaded))
+    {
+        int i = loaded.model;
+        Clock::time_point uploadStart = Clock::now();
+        upload(loaded);
+        Clock::time_point uploadEnd = Clock::now();
+
+        readTime[i] += loaded.milliseconds;
+        uploadTime[i] += Milliseconds(uploadEnd - uploadStart).count();
+        readyTime[i] = Milliseconds(uploadEnd - start).count();
+    }
+
+    for (int i = 0; i < n; ++i)
+        std::cout << directories[i] << ": read " << readTime[i] << " ms, upload " << uploadTime[i] << " ms, ready after " << readyTime[i] << " ms" << std::endl;
+    std::cout << "Loaded " << n << " models with " << loader.getThreadCount() << " threads in " << Milliseconds(Clock::now() - start).count() << " ms" << std::endl;
+}
+
+void LodResidency::beginFrame()
+{
+    ++frame;
+
+    LoadedLod loaded;
+    while (loader.poll(loaded))
+        upload(loaded);
+
+    // The budget may have been lowered
+    evict(0);
+    compact();
+}
+
+void LodResidency::request(int model, int lod)
+{
+    Entry &entry = entries[model][lod];
+    if (entry.state != NOT_RESIDENT)
+        return;
+
+    // The coarsest LODs are always loaded, whatever the budget
+    if (lod > 0 && !evict(entry.bytes))
+        return;
+
+    entry.state = LOADING;
+    loadingBytes += entry.bytes;
+    loader.request(model, lod, directories[model]);
+}
+
+void LodResidency::finishLoading()
+{
+    LoadedLod loaded;
+    while (loader.wait(loaded))
+        upload(loaded);
+}
+
+void LodResidency::stopLoading()
+{
+    loader.stop();
+}
+
+int LodResidency::bestResident(int model, int lod)
+{
+    for (; lod >= 0; --lod)
+    {
+        Entry &entry = entries[model][lod];
+        if (entry.state == RESIDENT)
+        {
+            entry.lastUsed = frame;
+            return lod;
+        }
+    }
+    return -1;
+}
+
+bool LodResidency::isAvailable(int model, int lod) const
+{
+    return entries[model][lod].state != FAILED;
+}
+
+void LodResidency::setBudget(size_t bytes)
+{
+    budget = bytes;
+}
+
+size_t LodResidency::getBudget() const
+{
+    return budget;
+}
+
+size_t LodResidency::getResidentBytes() const
+{
+    return residentBytes;
+}
+
+int LodResidency::getLoadingCount() const
+{
+    return loader.getPendingCount();
+}
+
+void LodResidency::upload(LoadedLod &loaded)
+{
+    Entry &entry = entries[loaded.model][loaded.lod];
+    loadingBytes -= entry.bytes;
+    if (!loaded.loaded)
+    {
+        std::cerr << "Couldn't load LOD " << loaded.lod << " of " << directories[loaded.model] << std::endl;
+        entry.state = FAILED;
+        return;
+    }
+
+    MeshLods &meshLods = (*models)[loaded.model];
+    TriangleMesh &mesh = meshLods.lods[loaded.lod];
+    mesh = std::move(loaded.mesh);
+    mesh.sendToOpenGL(*arena, loaded.getVertexData(), loaded.nVertices, loaded.getIndices(), loaded.nTriangles);
+    mesh.freeGeometry();
+
+    meshLods.info[loaded.lod].triangles = loaded.nTriangles;
+    meshLods.info[loaded.lod].vertices = loaded.nVertices;
+    entry.bytes = bufferSize(loaded.nVertices, loaded.nTriangles);
+
+    // A triangle soup would take 3 vertices per triangle and have an ACMR of 3
+    std::cout << directories[loaded.model] << " LOD " << loaded.lod << ": " << loaded.nTriangles << " triangles, "
+              << loaded.nVertices << " vertices, " << entry.bytes / 1024 << " KB (soup " << bufferSize(3 * loaded.nTriangles, 0) / 1024 << " KB), "
+              << "ACMR " << loaded.originalStats.acmr << " -> " << loaded.stats.acmr << ", ATVR " << loaded.originalStats.atvr << " -> " << loaded.stats.atvr << std::endl;
+    entry.state = RESIDENT;
+    entry.lastUsed = frame;
+    residentBytes += entry.bytes;
+}
+
+// Evicts LRU LODs until bytes more fit in the budget, false if they can't
+bool LodResidency::evict(size_t bytes)
+{
+    while (residentBytes + loadingBytes + bytes > budget)
+    {
+        // LODs used in this frame or the previous one are likely to be rendered now
+        Entry *victim = nullptr;
+        int victimModel = 0, victimLod = 0;
+        long long oldest = frame - 1;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            for (unsigned int lod = 1; lod < entries[i].size(); ++lod)
+            {
+                Entry &entry = entries[i][lod];
+                if (entry.state == RESIDENT && entry.lastUsed < oldest)
+                {
+                    victim = &entry;
+                    victimModel = i;
+                    victimLod = lod;
+                    oldest = entry.lastUsed;
+                }
+            }
+        }
+        if (victim == nullptr)
+            return false;
+
+        (*models)[victimModel].lods[victimLod].free();
+        victim->state = NOT_RESIDENT;
+        residentBytes -= victim->bytes;
+        evicted = true;
+    }
+    return true;
+}
+
+// Moves the resident LODs down to the start of the arena, lowest first, and gives back the freed end
+void LodResidency::compact()
+{
+    size_t capacity = arena->getCapacityBytes();
+    if (!evicted || arena->getFreeBytes() < COMPACTION_THRESHOLD * capacity)
+        return;
+    evicted = false;
+
+    std::vector<TriangleMesh *> resident;
+    for (size_t i = 0; i < entries.size(); ++i)
+        for (unsigned int lod = 0; lod < entries[i].size(); ++lod)
+            if (entries[i][lod].state == RESIDENT)
+                resident.push_back(&(*models)[i].lods[lod]);
+    std::sort(resident.begin(), resident.end(), [](const TriangleMesh *a, const TriangleMesh *b) {
+        return a->getArenaRange().baseVertex < b->getArenaRange().baseVertex;
+    });
+    for (TriangleMesh *mesh : resident)
+        mesh->relocate();
+
+    arena->shrink();
+    if (arena->getCapacityBytes() < capacity)
+        std::cout << "Compacted geometry arena: " << capacity / 1024 << " KB -> " << arena->getCapacityBytes() / 1024 << " KB" << std::endl;
+}
@@ -0,0 +1,79 @@
+#ifndef LODRESIDENCY_H
+#define LODRESIDENCY_H
+
+#include "ModelLoader.h"
+#include "GeometryArena.h"
+#include "TimeCritical.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// LodResidency decides which LODs of the museum models live in OpenGL buffers.
+// The coarsest LOD of every model is loaded at startup and always stays
+// resident. Finer LODs are streamed in the background when they are requested,
+// as long as they fit in the memory budget, and the least recently used ones
+// are evicted to make room for them. When evictions leave most of the geometry
+// arena free, the resident LODs are packed at its start and it shrinks.
+
+class LodResidency
+{
+
+public:
+    LodResidency();
+
+    // Finds the LODs of every model, with their metadata, and loads the coarsest ones
+    void init(std::vector<MeshLods> &models, const std::vector<std::string> &directories, GeometryArena &arena);
+
+    // Uploads the LODs loaded since the last frame, evicts when over budget and compacts the arena
+    void beginFrame();
+
+    // Starts loading the LOD if it isn't resident and fits in the budget
+    void request(int model, int lod);
+
+    // Blocks until every requested LOD is uploaded, for frames that must not depend on loading times
+    void finishLoading();
+
+    // Stops the loader threads, before the trace is written at exit
+    void stopLoading();
+
+    // Finest resident LOD not finer than lod, marked as used this frame
+    int bestResident(int model, int lod);
+
+    // False if the LOD couldn't be found or loaded
+    bool isAvailable(int model, int lod) const;
+
+    void setBudget(size_t bytes);
+    size_t getBudget() const;
+    size_t getResidentBytes() const;
+    int getLoadingCount() const;
+
+private:
+    enum State { NOT_RESIDENT, LOADING, RESIDENT, FAILED };
+
+    struct Entry
+    {
+        State state;
+        size_t bytes;
+        long long lastUsed; // Frame in which it was last rendered
+    };
+
+    void upload(LoadedLod &loaded);
+    bool evict(size_t bytes);
+    void compact();
+    std::string lodFilename(int model, int lod) const;
+
+private:
+    std::vector<MeshLods> *models;
+    std::vector<std::string> directories;
+    GeometryArena *arena;
+    std::vector<std::vector<Entry>> entries;
+    size_t budget;
+    size_t residentBytes;
+    size_t loadingBytes;
+    long long frame;
+    bool evicted; // Since the last compaction
+    ModelLoader loader; // Declared last so that workers stop before anything else is destroyed
+};
+
+#endif // LODRESIDENCY_H
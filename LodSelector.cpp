@@ -0,0 +1,508 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+// Heap orders: upgrades with the highest value and downgrades with the lowest one are on top
+bool LodSelector::bestUpgradeLast(const Move &lhs, const Move &rhs)
+{
+    return lhs.value < rhs.value;
+}
+
+bool LodSelector::worstDowngradeLast(const Move &lhs, const Move &rhs)
+{
+    return lhs.value > rhs.value;
+}
+
+LodSelector::LodSelector()
+{
+    frame = 0;
+    solver = LOD_SOLVER_INCREMENTAL;
+    timeLimit = DEFAULT_SOLVER_TIME_LIMIT;
+    cost = 0.0f;
+    benefit = 0.0f;
+    upperBound = -1.0f;
+    cheapestUpgrade = 0.0f;
+    moves = 0;
+}
+
+void LodSelector::clear()
+{
+    candidates.clear();
+    benefits.clear();
+    costs.clear();
+}
+
+void LodSelector::add(int id, int nLods, const float *benefit, const float *cost)
+{
+    if (id >= int(previousLod.size()))
+    {
+        previousLod.resize(id + 1, 0);
+        previousFrame.resize(id + 1, -1);
+    }
+    candidates.push_back({id, std::max(nLods, 1), int(benefits.size()), 0});
+    benefits.insert(benefits.end(), benefit, benefit + nLods);
+    costs.insert(costs.end(), cost, cost + nLods);
+}
+
+void LodSelector::select(float budget)
+{
+    ++frame;
+    deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<float, std::milli>(std::max(timeLimit, 0.0f)));
+    cost = 0.0f;
+    benefit = 0.0f;
+    upperBound = -1.0f;
+    moves = 0;
+    upgrades.clear();
+    downgrades.clear();
+    skipped.clear();
+    cheapestUpgrade = std::numeric_limits<float>::max();
+
+    if (solver == LOD_SOLVER_GREEDY)
+        selectGreedy(budget);
+    else if (solver == LOD_SOLVER_HULL)
+        selectHull(budget);
+    else
+        selectIncremental(budget);
+
+    for (const Candidate &candidate : candidates)
+    {
+        previousLod[candidate.id] = candidate.lod;
+        previousFrame[candidate.id] = frame;
+    }
+}
+
+void LodSelector::selectIncremental(float budget)
+{
+    // Start from the previous assignment, objects that weren't candidates in the last frame start coarsest
+    for (unsigned int i = 0; i < candidates.size(); ++i)
+    {
+        Candidate &candidate = candidates[i];
+        if (previousFrame[candidate.id] == frame - 1)
+            candidate.lod = std::min(previousLod[candidate.id], candidate.nLods - 1);
+        else
+            candidate.lod = 0;
+        cost += costOf(i, candidate.lod);
+        benefit += benefitOf(i, candidate.lod);
+        if (candidate.lod + 1 < candidate.nLods)
+        {
+            upgrades.push_back({int(i), candidate.lod, valueOf(i, candidate.lod, candidate.lod + 1)});
+            cheapestUpgrade = std::min(cheapestUpgrade, costOf(i, candidate.lod + 1) - costOf(i, candidate.lod));
+        }
+        if (candidate.lod > 0)
+            downgrades.push_back({int(i), candidate.lod, valueOf(i, candidate.lod - 1, candidate.lod)});
+    }
+    std::make_heap(upgrades.begin(), upgrades.end(), bestUpgradeLast);
+    std::make_heap(downgrades.begin(), downgrades.end(), worstDowngradeLast);
+
+    // Downgrade what is worth the least until the assignment fits again
+    Move move;
+    while (cost > budget && peek(downgrades, false, move))
+    {
+        pop(downgrades, false);
+        apply(move.candidate, move.lod - 1);
+    }
+
+    // Then upgrade what is worth the most, paying with worse LODs when the budget runs out
+    int exchanges = 0;
+    while (peek(upgrades, true, move))
+    {
+        // When nothing fits without an exchange, the remaining upgrades are worth less than any downgrade
+        Move worst = {};
+        bool canDowngrade = peek(downgrades, false, worst);
+        if (budget - cost < cheapestUpgrade && (!canDowngrade || worst.value >= move.value))
+            break;
+
+        float upgradeCost = costOf(move.candidate, move.lod + 1) - costOf(move.candidate, move.lod);
+        if (cost + upgradeCost <= budget)
+        {
+            pop(upgrades, true);
+            apply(move.candidate, move.lod + 1);
+            continue;
+        }
+
+        // Pay for it with the least valuable downgrades, as long as they lose less benefit than it brings
+        if (exchanges < int(candidates.size()) && canDowngrade && worst.value < move.value)
+        {
+            float upgradeBenefit = benefitOf(move.candidate, move.lod + 1) - benefitOf(move.candidate, move.lod);
+            float freedCost = 0.0f;
+            float lostBenefit = 0.0f;
+            bool ownDowngradePopped = false;
+            payments.clear();
+            while (cost - freedCost + upgradeCost > budget && lostBenefit < upgradeBenefit &&
+                   peek(downgrades, false, worst) && worst.value < move.value)
+            {
+                pop(downgrades, false);
+                if (worst.candidate == move.candidate)
+                {
+                    ownDowngradePopped = true;
+                    continue;
+                }
+                // Skip the copies of a move that is already paying
+                bool isCopy = false;
+                for (const Move &payment : payments)
+                    isCopy = isCopy || payment.candidate == worst.candidate;
+                if (isCopy)
+                    continue;
+                payments.push_back(worst);
+                freedCost += costOf(worst.candidate, worst.lod) - costOf(worst.candidate, worst.lod - 1);
+                lostBenefit += benefitOf(worst.candidate, worst.lod) - benefitOf(worst.candidate, worst.lod - 1);
+            }
+
+            if (cost - freedCost + upgradeCost <= budget && lostBenefit < upgradeBenefit)
+            {
+                pop(upgrades, true);
+                for (const Move &payment : payments)
+                    apply(payment.candidate, payment.lod - 1);
+                apply(move.candidate, move.lod + 1);
+                ++exchanges;
+                continue;
+            }
+
+            for (const Move &payment : payments)
+                pushDowngrade(payment.candidate);
+            if (ownDowngradePopped)
+                pushDowngrade(move.candidate);
+        }
+
+        // Doesn't fit now, but it might once exchanges free some budget
+        pop(upgrades, true);
+        skipped.push_back(move);
+    }
+
+    // Fill what the exchanges left of the budget with the skipped upgrades that still fit
+    for (const Move &skippedMove : skipped)
+    {
+        if (candidates[skippedMove.candidate].lod == skippedMove.lod)
+            pushUpgrade(skippedMove.candidate);
+    }
+    while (peek(upgrades, true, move))
+    {
+        pop(upgrades, true);
+        if (cost + costOf(move.candidate, move.lod + 1) - costOf(move.candidate, move.lod) <= budget)
+            apply(move.candidate, move.lod + 1);
+    }
+}
+
+void LodSelector::selectGreedy(float budget)
+{
+    for (unsigned int i = 0; i < candidates.size(); ++i)
+    {
+        candidates[i].lod = 0;
+        cost += costOf(i, 0);
+        benefit += benefitOf(i, 0);
+        pushUpgrade(i);
+    }
+
+    Move move;
+    while (peek(upgrades, true, move))
+    {
+        pop(upgrades, true);
+        if (cost + costOf(move.candidate, move.lod + 1) - costOf(move.candidate, move.lod) <= budget)
+            apply(move.candidate, move.lod + 1);
+    }
+}
+
+void LodSelector::selectHull(float budget)
+{
+    for (unsigned int i = 0; i < candidates.size(); ++i)
+    {
+        candidates[i].lod = 0;
+        cost += costOf(i, 0);
+        benefit += benefitOf(i, 0);
+    }
+    buildHulls();
+
+    // The steps that fit, by decreasing slope, solve the LP relaxation up to the first one that doesn't
+    std::vector<int> rejected;
+    for (int s : order)
+    {
+        const Segment &segment = segments[s];
+        if (candidates[segment.candidate].lod != segment.from)
+            continue;
+        if (cost + segment.cost <= budget)
+        {
+            candidates[segment.candidate].lod = segment.to;
+            hullTop[segment.candidate] = s;
+            cost += segment.cost;
+            benefit += segment.benefit;
+            ++moves;
+            continue;
+        }
+        if (upperBound < 0.0f)
+            upperBound = benefit + segment.benefit * std::max(0.0f, budget - cost) / segment.cost;
+        rejected.push_back(s);
+    }
+    if (upperBound < 0.0f)
+        upperBound = benefit;
+
+    // Try to make room for the rejected steps, the most valuable first, while there is time
+    takenTops.clear();
+    for (int top : hullTop)
+    {
+        if (top >= 0)
+            takenTops.push_back(top);
+    }
+    auto lowestSlopeFirst = [this](int lhs, int rhs) { return segments[lhs].slope > segments[rhs].slope; };
+    std::make_heap(takenTops.begin(), takenTops.end(), lowestSlopeFirst);
+    for (int s : rejected)
+    {
+        if (timeIsUp())
+            break;
+        if (candidates[segments[s].candidate].lod == segments[s].from)
+            exchange(s, budget);
+    }
+}
+
+// Hull segments of every candidate, and their order by decreasing slope
+void LodSelector::buildHulls()
+{
+    segments.clear();
+    order.clear();
+    hullTop.assign(candidates.size(), -1);
+
+    std::vector<int> hull;
+    for (unsigned int i = 0; i < candidates.size(); ++i)
+    {
+        // LODs that aren't cheaper and better than the last one on the hull can't be part of it
+        hull.assign(1, 0);
+        for (int lod = 1; lod < candidates[i].nLods; ++lod)
+        {
+            if (costOf(i, lod) <= costOf(i, hull.back()) || benefitOf(i, lod) <= benefitOf(i, hull.back()))
+                continue;
+            while (hull.size() >= 2 && valueOf(i, hull[hull.size() - 2], hull.back()) <= valueOf(i, hull.back(), lod))
+                hull.pop_back();
+            hull.push_back(lod);
+        }
+
+        int previous = -1;
+        for (unsigned int k = 1; k < hull.size(); ++k)
+        {
+            float segmentCost = costOf(i, hull[k]) - costOf(i, hull[k - 1]);
+            float segmentBenefit = benefitOf(i, hull[k]) - benefitOf(i, hull[k - 1]);
+            segments.push_back({int(i), hull[k - 1], hull[k], previous, segmentCost, segmentBenefit, segmentBenefit / segmentCost});
+            previous = segments.size() - 1;
+        }
+    }
+
+    // Slopes decrease along each hull, so its segments are sorted in order
+    for (unsigned int s = 0; s < segments.size(); ++s)
+        order.push_back(s);
+    std::sort(order.begin(), order.end(), [this](int lhs, int rhs) {
+        return segments[lhs].slope > segments[rhs].slope || (segments[lhs].slope == segments[rhs].slope && lhs < rhs);
+    });
+}
+
+// Takes the segment by undoing the last segments of other candidates with the lowest slopes, if it pays off
+bool LodSelector::exchange(int s, float budget)
+{
+    const Segment &segment = segments[s];
+    auto lowestSlopeFirst = [this](int lhs, int rhs) { return segments[lhs].slope > segments[rhs].slope; };
+    auto pushTop = [&](int top) {
+        takenTops.push_back(top);
+        std::push_heap(takenTops.begin(), takenTops.end(), lowestSlopeFirst);
+    };
+
+    std::vector<int> undone, kept;
+    float freed = 0.0f;
+    float lost = 0.0f;
+    while (cost - freed + segment.cost > budget && lost < segment.benefit && !takenTops.empty())
+    {
+        int top = takenTops.front();
+        std::pop_heap(takenTops.begin(), takenTops.end(), lowestSlopeFirst);
+        takenTops.pop_back();
+        if (hullTop[segments[top].candidate] != top)
+            continue;
+        (segments[top].candidate == segment.candidate ? kept : undone).push_back(top);
+        if (segments[top].candidate != segment.candidate)
+        {
+            freed += segments[top].cost;
+            lost += segments[top].benefit;
+        }
+    }
+    for (int top : kept)
+        pushTop(top);
+
+    if (cost - freed + segment.cost > budget || lost >= segment.benefit)
+    {
+        for (int top : undone)
+            pushTop(top);
+        return false;
+    }
+
+    // The previous segment of each undone candidate becomes its last one
+    for (int top : undone)
+    {
+        const Segment &taken = segments[top];
+        candidates[taken.candidate].lod = taken.from;
+        hullTop[taken.candidate] = taken.previous;
+        cost -= taken.cost;
+        benefit -= taken.benefit;
+        ++moves;
+        if (taken.previous >= 0)
+            pushTop(taken.previous);
+    }
+    candidates[segment.candidate].lod = segment.to;
+    hullTop[segment.candidate] = s;
+    cost += segment.cost;
+    benefit += segment.benefit;
+    ++moves;
+    pushTop(s);
+    return true;
+}
+
+bool LodSelector::timeIsUp() const
+{
+    return timeLimit >= 0.0f && std::chrono::steady_clock::now() >= deadline;
+}
+
+void LodSelector::setSolver(LodSolver solver)
+{
+    this->solver = solver;
+}
+
+LodSolver LodSelector::getSolver() const
+{
+    return solver;
+}
+
+void LodSelector::setTimeLimit(float milliseconds)
+{
+    timeLimit = milliseconds;
+}
+
+void LodSelector::writeProblem(std::ostream &out, float budget) const
+{
+    out << "selection " << budget << " " << candidates.size() << "\n";
+    for (const Candidate &candidate : candidates)
+    {
+        out << candidate.id << " " << candidate.nLods;
+        for (int lod = 0; lod < candidate.nLods; ++lod)
+            out << " " << benefits[candidate.first + lod] << " " << costs[candidate.first + lod];
+        out << "\n";
+    }
+}
+
+bool LodSelector::readProblem(std::istream &in, float &budget)
+{
+    std::string keyword;
+    int nCandidates;
+    if (!(in >> keyword >> budget >> nCandidates) || keyword != "selection" || nCandidates < 0)
+        return false;
+
+    clear();
+    std::vector<float> benefit, cost;
+    for (int i = 0; i < nCandidates; ++i)
+    {
+        int id, nLods;
+        if (!(in >> id >> nLods) || id < 0 || nLods < 1)
+            return false;
+        benefit.resize(nLods);
+        cost.resize(nLods);
+        for (int lod = 0; lod < nLods; ++lod)
+        {
+            if (!(in >> benefit[lod] >> cost[lod]))
+                return false;
+        }
+        add(id, nLods, benefit.data(), cost.data());
+    }
+    return true;
+}
+
+int LodSelector::getLod(int candidate) const
+{
+    return candidates[candidate].lod;
+}
+
+float LodSelector::getCost() const
+{
+    return cost;
+}
+
+float LodSelector::getBenefit() const
+{
+    return benefit;
+}
+
+int LodSelector::getMoveCount() const
+{
+    return moves;
+}
+
+float LodSelector::getUpperBound() const
+{
+    return upperBound;
+}
+
+float LodSelector::benefitOf(int candidate, int lod) const
+{
+    return benefits[candidates[candidate].first + lod];
+}
+
+float LodSelector::costOf(int candidate, int lod) const
+{
+    return costs[candidates[candidate].first + lod];
+}
+
+float LodSelector::valueOf(int candidate, int from, int to) const
+{
+    float deltaCost = costOf(candidate, to) - costOf(candidate, from);
+    float deltaBenefit = benefitOf(candidate, to) - benefitOf(candidate, from);
+    if (deltaCost == 0.0f)
+        return deltaBenefit >= 0.0f ? std::numeric_limits<float>::max() : -std::numeric_limits<float>::max();
+    return deltaBenefit / deltaCost;
+}
+
+void LodSelector::pushUpgrade(int candidate)
+{
+    int lod = candidates[candidate].lod;
+    if (lod + 1 >= candidates[candidate].nLods)
+        return;
+    upgrades.push_back({candidate, lod, valueOf(candidate, lod, lod + 1)});
+    cheapestUpgrade = std::min(cheapestUpgrade, costOf(candidate, lod + 1) - costOf(candidate, lod));
+    std::push_heap(upgrades.begin(), upgrades.end(), bestUpgradeLast);
+}
+
+void LodSelector::pushDowngrade(int candidate)
+{
+    int lod = candidates[candidate].lod;
+    if (lod == 0)
+        return;
+    downgrades.push_back({candidate, lod, valueOf(candidate, lod - 1, lod)});
+    std::push_heap(downgrades.begin(), downgrades.end(), worstDowngradeLast);
+}
+
+// Top of the heap, after dropping the moves made stale by later changes of their candidate
+bool LodSelector::peek(std::vector<Move> &heap, bool isUpgrade, Move &move)
+{
+    while (!heap.empty())
+    {
+        move = heap.front();
+        if (candidates[move.candidate].lod == move.lod)
+            return true;
+        pop(heap, isUpgrade);
+    }
+    return false;
+}
+
+void LodSelector::pop(std::vector<Move> &heap, bool isUpgrade)
+{
+    if (isUpgrade)
+        std::pop_heap(heap.begin(), heap.end(), bestUpgradeLast);
+    else
+        std::pop_heap(heap.begin(), heap.end(), worstDowngradeLast);
+    heap.pop_back();
+}
+
+void LodSelector::apply(int candidate, int lod)
+{
+    Candidate &selected = candidates[candidate];
+    cost += costOf(candidate, lod) - costOf(candidate, selected.lod);
+    benefit += benefitOf(candidate, lod) - benefitOf(candidate, selected.lod);
+    selected.lod = lod;
+    ++moves;
+    pushUpgrade(candidate);
+    pushDowngrade(candidate);
+}
@@ -0,0 +1,148 @@
+#ifndef LODSELECTOR_H
+#define LODSELECTOR_H
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Default time allowed to improve a solution, in milliseconds
+constexpr float DEFAULT_SOLVER_TIME_LIMIT = 1.0f;
+
+// Lets the solver improve the solution until it can't, so that it doesn't depend on the speed of the machine
+constexpr float NO_SOLVER_TIME_LIMIT = -1.0f;
+
+enum LodSolver
+{
+    LOD_SOLVER_INCREMENTAL, // Fixes the assignment of the previous frame
+    LOD_SOLVER_GREEDY, // Upgrades from the coarsest LODs by benefit per unit of cost
+    LOD_SOLVER_HULL, // Rounds the LP relaxation over the convex hulls, then improves it
+};
+
+// LodSelector assigns a LOD to each candidate object so that the total
+// benefit is as high as possible without the total cost going over a budget,
+// a multiple-choice knapsack problem. Three solvers are available:
+//
+// - Incremental: every object starts from the LOD it had in the last frame it
+//   was a candidate, and the assignment is fixed with downgrades until it fits
+//   the budget, then with upgrades and exchanges (downgrades paying for a
+//   better upgrade) ordered by benefit per unit of cost, and the budget left
+//   is filled with the upgrades that didn't fit before. When the camera moves
+//   a little, only a few moves are needed. It is a local search, so it can
+//   stay a little below the greedy solver: up to 0.7% on drifting problems.
+// - Greedy: every object starts from its coarsest LOD and is upgraded one LOD
+//   at a time, the most valuable upgrades first.
+// - Hull: the LOD steps that are on the upper convex hull of the (cost,
+//   benefit) points of each object are taken by decreasing slope, which
+//   solves the LP relaxation and gives an upper bound of the optimum. The
+//   rounded solution is then improved with exchanges until the time limit.
+//
+// Its storage is reused from one frame to the next.
+
+class LodSelector
+{
+
+public:
+    LodSelector();
+
+    // Removes the candidates of the previous frame
+    void clear();
+
+    // benefit and cost hold the accumulated values of LODs 0 to nLods - 1, id identifies the object across frames
+    void add(int id, int nLods, const float *benefit, const float *cost);
+
+    // Assigns the LODs of all candidates, the coarsest ones are always paid for
+    void select(float budget);
+
+    void setSolver(LodSolver solver);
+    LodSolver getSolver() const;
+    void setTimeLimit(float milliseconds); // Negative for no limit
+
+    // Candidates and budget of a selection, as text
+    void writeProblem(std::ostream &out, float budget) const;
+    bool readProblem(std::istream &in, float &budget);
+
+    int getLod(int candidate) const;
+    float getCost() const;
+    float getBenefit() const;
+    int getMoveCount() const; // LOD changes made by the last selection
+    float getUpperBound() const; // Of the optimal benefit, only known by the hull solver, negative otherwise
+
+private:
+    // Change of a candidate from lod to the next finer or coarser LOD
+    struct Move
+    {
+        int candidate;
+        int lod;
+        float value; // Benefit per unit of cost
+    };
+
+    struct Candidate
+    {
+        int id;
+        int nLods;
+        int first; // Of its LODs in benefits and costs
+        int lod;
+    };
+
+    // Step between two LODs on the convex hull of a candidate
+    struct Segment
+    {
+        int candidate;
+        int from;
+        int to;
+        int previous; // Segment ending at from, -1 if from is the coarsest LOD
+        float cost;
+        float benefit;
+        float slope;
+    };
+
+    void selectIncremental(float budget);
+    void selectGreedy(float budget);
+    void selectHull(float budget);
+    void buildHulls();
+    bool exchange(int segment, float budget);
+    bool timeIsUp() const;
+
+    static bool bestUpgradeLast(const Move &lhs, const Move &rhs);
+    static bool worstDowngradeLast(const Move &lhs, const Move &rhs);
+
+    float benefitOf(int candidate, int lod) const;
+    float costOf(int candidate, int lod) const;
+    float valueOf(int candidate, int from, int to) const;
+
+    void pushUpgrade(int candidate);
+    void pushDowngrade(int candidate);
+    bool peek(std::vector<Move> &heap, bool isUpgrade, Move &move);
+    void pop(std::vector<Move> &heap, bool isUpgrade);
+    void apply(int candidate, int lod);
+
+private:
+    std::vector<Candidate> candidates;
+    std::vector<float> benefits;
+    std::vector<float> costs;
+    std::vector<Move> upgrades; // Heap, best first
+    std::vector<Move> downgrades; // Heap, worst first
+    std::vector<Move> skipped; // Upgrades that didn't fit in the budget
+    std::vector<Move> payments; // Downgrades paying for an upgrade
+    std::vector<Segment> segments;
+    std::vector<int> order; // Of the segments, by decreasing slope
+    std::vector<int> hullTop; // Last segment taken by each candidate, -1 if none
+    std::vector<int> takenTops; // Heap of the hullTop segments, lowest slope first
+
+    // LOD and frame of the last selection of each id
+    std::vector<int> previousLod;
+    std::vector<long long> previousFrame;
+    long long frame;
+
+    LodSolver solver;
+    float timeLimit;
+    std::chrono::steady_clock::time_point deadline;
+
+    float cost;
+    float benefit;
+    float upperBound;
+    float cheapestUpgrade; // Cost of the cheapest upgrade pushed in this selection
+    int moves;
+};
+
+#endif // LODSELECTOR_H
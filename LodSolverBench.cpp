@@ -0,0 +1,102 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Replays the LOD selection problems recorded by the museum viewer ("Record
+// LOD problems" in the settings window) with every solver, and compares their
+// total benefit with the greedy solver and their solve time.
+
+struct SolverResult
+{
+    std::vector<float> benefit; // Of each problem
+    std::vector<double> milliseconds;
+    float worstGap; // Largest relative distance to the upper bound, when known
+};
+
+// Every problem is solved in order, so that the incremental solver sees consecutive frames
+bool solveAll(const std::string &filename, LodSolver solver, float timeLimit, SolverResult &result)
+{
+    std::ifstream fin(filename);
+    if (!fin.is_open())
+        return false;
+
+    LodSelector selector;
+    selector.setSolver(solver);
+    selector.setTimeLimit(timeLimit);
+    result = {{}, {}, 0.0f};
+
+    float budget;
+    while (selector.readProblem(fin, budget))
+    {
+        auto start = std::chrono::steady_clock::now();
+        selector.select(budget);
+        auto end = std::chrono::steady_clock::now();
+
+        result.benefit.push_back(selector.getBenefit());
+        result.milliseconds.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        if (selector.getUpperBound() > 0.0f)
+            result.worstGap = std::max(result.worstGap, 1.0f - selector.getBenefit() / selector.getUpperBound());
+    }
+    return !result.benefit.empty();
+}
+
+const std::string DEFAULT_PROBLEMS = "lod_problems.txt";
+
+int main(int argc, char **argv)
+{
+    std::string problems_filename = DEFAULT_PROBLEMS;
+    if (argc > 1)
+    {
+        problems_filename = std::string(argv[1]);
+    }
+
+    float timeLimit = DEFAULT_SOLVER_TIME_LIMIT;
+    if (argc > 2)
+    {
+        timeLimit = std::max(0.0f, float(std::atof(argv[2])));
+    }
+
+    const LodSolver solvers[] = {LOD_SOLVER_GREEDY, LOD_SOLVER_INCREMENTAL, LOD_SOLVER_HULL};
+    const std::string names[] = {"Greedy:     ", "Incremental:", "Hull:       "};
+    SolverResult results[3];
+    for (int s = 0; s < 3; ++s)
+    {
+        if (!solveAll(problems_filename, solvers[s], timeLimit, results[s]))
+        {
+            std::cerr << "Failed to read the problems in " << problems_filename << std::endl;
+            return -1;
+        }
+    }
+
+    const SolverResult &greedy = results[0];
+    std::cout << problems_filename << ": " << greedy.benefit.size() << " problems, time limit " << timeLimit << " ms" << std::endl;
+    for (int s = 0; s < 3; ++s)
+    {
+        const SolverResult &result = results[s];
+        double relative = 0.0, meanTime = 0.0, maxTime = 0.0;
+        int better = 0, worse = 0;
+        for (unsigned int i = 0; i < result.benefit.size(); ++i)
+        {
+            relative += greedy.benefit[i] > 0.0f ? result.benefit[i] / greedy.benefit[i] : 1.0;
+            better += result.benefit[i] > greedy.benefit[i];
+            worse += result.benefit[i] < greedy.benefit[i];
+            meanTime += result.milliseconds[i];
+            maxTime = std::max(maxTime, result.milliseconds[i]);
+        }
+        relative /= result.benefit.size();
+        meanTime /= result.benefit.size();
+
+        std::cout << "\t" << names[s] << " benefit " << relative << "x greedy (" << better << " better, " << worse << " worse), "
+                  << meanTime << " ms mean, " << maxTime << " ms max";
+        if (solvers[s] == LOD_SOLVER_HULL)
+            std::cout << ", within " << 100.0f * result.worstGap << "% of optimal";
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile()
+{
+    mapping = nullptr;
+    length = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string &filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps its own reference to the file
+    if (address == MAP_FAILED)
+        return false;
+
+    // The whole file is going to be read front to back
+    madvise(address, info.st_size, MADV_SEQUENTIAL);
+
+    mapping = static_cast<const char *>(address);
+    length = info.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mapping)
+        munmap(const_cast<char *>(mapping), length);
+    mapping = nullptr;
+    length = 0;
+}
+
+bool MappedFile::isOpen() const
+{
+    return mapping != nullptr;
+}
+
+const char *MappedFile::data() const
+{
+    return mapping;
+}
+
+size_t MappedFile::size() const
+{
+    return length;
+}
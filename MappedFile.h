@@ -0,0 +1,33 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// MappedFile maps a whole file read-only into the address space so that it
+// can be decoded in bulk instead of going through a stream element by element.
+// The mapping is released when the file is closed or the object destroyed.
+
+class MappedFile
+{
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &filename);
+    void close();
+
+    bool isOpen() const;
+    const char *data() const;
+    size_t size() const;
+
+private:
+    const char *mapping;
+    size_t length;
+};
+
+#endif // MAPPEDFILE_H
@@ -1,14 +1,21 @@
+#include "LodBundle.h"
+#include "LodMetadata.h"
 #include "Octree.h"
 #include "PLYReader.h"
 #include "PLYWriter.h"
+#include "Trace.h"
 #include "TriangleMesh.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -25,7 +32,11 @@ Plane face(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2)
 {
     glm::vec3 u = v1 - v0;
     glm::vec3 v = v2 - v0;
-    glm::vec3 n = glm::normalize(glm::cross(u, v));
+    glm::vec3 n = glm::cross(u, v);
+
+    // Degenerate triangles have no plane, a null one leaves the quadrics unchanged
+    if (glm::dot(n, n) == 0.0f) return Plane(0, 0, 0, 0);
+    n = glm::normalize(n);
     float d = -glm::dot(v0, n);
     Plane result;
     result << n.x, n.y, n.z, d;
@@ -61,8 +72,12 @@ void computeRepresentativesByCorners(const TriangleMesh &originalMesh, Octree &o
     }
 }
 
-void addVertices(const TriangleMesh &originalMesh, TriangleMesh &simplifiedMesh, std::unordered_map<int, int> &originalToSimplifiedIndex, const std::vector<OctreeNode*> &representative, bool QEM) 
+// Output is either a TriangleMesh or a PLYWriter streaming the LOD to disk
+// simplifiedVertices receives the vertices added to the simplified mesh
+template <typename Output>
+void addVertices(const TriangleMesh &originalMesh, Output &simplifiedMesh, std::unordered_map<int, int> &originalToSimplifiedIndex, std::vector<glm::vec3> &simplifiedVertices, const std::vector<OctreeNode*> &representative, bool QEM) 
 {
+    TRACE_SCOPE("addVertices");
     std::unordered_map<OctreeNode*, int> simplifiedMeshVertices;
     int j = 0;
     for (int i = 0; i < originalMesh.vertices.size(); ++i)
@@ -70,8 +85,9 @@ void addVertices(const TriangleMesh &originalMesh, TriangleMesh &simplifiedMesh,
         bool vertex_found = (simplifiedMeshVertices.find(representative[i]) != simplifiedMeshVertices.end());
         if (!vertex_found)
         {
-            if (QEM) simplifiedMesh.addVertex(Octree::QEM(representative[i]));
-            else simplifiedMesh.addVertex(Octree::average(representative[i]));
+            if (QEM) simplifiedVertices.push_back(Octree::QEM(representative[i]));
+            else simplifiedVertices.push_back(Octree::average(representative[i]));
+            simplifiedMesh.addVertex(simplifiedVertices.back());
             simplifiedMeshVertices[representative[i]] = j;
             originalToSimplifiedIndex[i] = j++;
         }
@@ -82,8 +98,10 @@ void addVertices(const TriangleMesh &originalMesh, TriangleMesh &simplifiedMesh,
     }
 }
 
-void addFaces(const TriangleMesh &originalMesh, TriangleMesh &simplifiedMesh, const std::unordered_map<int, int> &originalToSimplifiedIndex)
+template <typename Output>
+void addFaces(const TriangleMesh &originalMesh, Output &simplifiedMesh, const std::unordered_map<int, int> &originalToSimplifiedIndex)
 {
+    TRACE_SCOPE("addFaces");
     std::unordered_set<glm::ivec3> simplifiedMeshTriangles;
     for (int i = 0; i < originalMesh.triangles.size(); i += 3)
     {
@@ -126,56 +144,327 @@ void addFaces(const TriangleMesh &originalMesh, TriangleMesh &simplifiedMesh, co
     }
 }
 
-TriangleMesh ObtainQuadricErrorMethodLOD(const TriangleMesh &mesh, const std::vector<OctreeNode*> &representative)
+// Closest point to p of the triangle abc, from Ericson's Real-Time Collision Detection
+glm::vec3 closestPointOnTriangle(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return b;
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return c;
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    float denominator = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+bool isDegenerate(const glm::vec3 *triangle)
+{
+    glm::vec3 n = glm::cross(triangle[1] - triangle[0], triangle[2] - triangle[0]);
+    return glm::dot(n, n) == 0.0f;
+}
+
+// Uniform grid over the triangles of a mesh, to find the closest one to a point without looking at all of them
+class TriangleGrid
+{
+public:
+    // triangles holds 3 corners per triangle, at least one triangle and none of them degenerate
+    explicit TriangleGrid(const std::vector<glm::vec3> &triangles) : triangles(triangles), stamp(0)
+    {
+        AABB bounds;
+        for (const glm::vec3 &corner : triangles)
+        {
+            bounds.min = glm::min(bounds.min, corner);
+            bounds.max = glm::max(bounds.max, corner);
+        }
+        int nTriangles = triangles.size() / 3;
+        glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+
+        // Surfaces cross a number of cells that grows with the square of the cells per side, so this leaves a few
+        // triangles in each of them
+        int cellsPerSide = glm::clamp(int(std::sqrt(float(nTriangles))), 1, 128);
+        cellSize = std::max({extent.x, extent.y, extent.z}) / cellsPerSide;
+        origin = bounds.min;
+        resolution = glm::max(glm::ivec3(glm::ceil(extent / cellSize)), glm::ivec3(1));
+        visited.assign(nTriangles, -1);
+
+        // The triangles of cell c are cellTriangles[cellStart[c]] to cellTriangles[cellStart[c + 1] - 1]
+        cellStart.assign(resolution.x * resolution.y * resolution.z + 1, 0);
+        forEachCell([&](int, int cell) { ++cellStart[cell + 1]; });
+        for (size_t cell = 1; cell < cellStart.size(); ++cell)
+            cellStart[cell] += cellStart[cell - 1];
+        cellTriangles.resize(cellStart.back());
+        std::vector<int> filled(cellStart.begin(), cellStart.end() - 1);
+        forEachCell([&](int t, int cell) { cellTriangles[filled[cell]++] = t; });
+    }
+
+    // Distance from p to the closest triangle
+    float distance(const glm::vec3 &p)
+    {
+        float best = std::numeric_limits<float>::infinity();
+
+        // Rings of cells around the cell of p, until the next ring can't be closer than the closest triangle. The
+        // cells of ring r are at least r - 1 cells plus the distance from p to the sides of its cell away from it
+        ++stamp;
+        glm::ivec3 center = cellOf(p);
+        glm::vec3 inCell = glm::clamp(p - origin - glm::vec3(center) * cellSize, glm::vec3(0.0f), glm::vec3(cellSize));
+        glm::vec3 sides = glm::min(inCell, glm::vec3(cellSize) - inCell);
+        float margin = std::min({sides.x, sides.y, sides.z});
+        int maxRing = std::max({resolution.x, resolution.y, resolution.z});
+        for (int ring = 0; ring < maxRing && (ring == 0 || best > (ring - 1) * cellSize + margin); ++ring)
+        {
+            glm::ivec3 low = glm::max(center - ring, glm::ivec3(0));
+            glm::ivec3 high = glm::min(center + ring, resolution - 1);
+            for (int x = low.x; x <= high.x; ++x)
+            {
+                for (int y = low.y; y <= high.y; ++y)
+                {
+                    for (int z = low.z; z <= high.z; ++z)
+                    {
+                        glm::ivec3 offset = glm::abs(glm::ivec3(x, y, z) - center);
+                        if (std::max({offset.x, offset.y, offset.z}) != ring) continue;
+                        int cell = index(x, y, z);
+                        for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+                        {
+                            int t = cellTriangles[i];
+                            if (visited[t] == stamp) continue;
+                            visited[t] = stamp;
+                            const glm::vec3 *corners = &triangles[3 * t];
+                            best = std::min(best, glm::length(p - closestPointOnTriangle(p, corners[0], corners[1], corners[2])));
+                        }
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+private:
+    glm::ivec3 cellOf(const glm::vec3 &p) const
+    {
+        return glm::clamp(glm::ivec3(glm::floor((p - origin) / cellSize)), glm::ivec3(0), resolution - 1);
+    }
+
+    int index(int x, int y, int z) const
+    {
+        return (x * resolution.y + y) * resolution.z + z;
+    }
+
+    // Calls f(triangle, cell) for every cell that the bounding box of each triangle overlaps
+    template <typename F>
+    void forEachCell(F f) const
+    {
+        for (int t = 0; t < int(triangles.size() / 3); ++t)
+        {
+            const glm::vec3 *corners = &triangles[3 * t];
+            glm::ivec3 low = cellOf(glm::min(corners[0], glm::min(corners[1], corners[2])));
+            glm::ivec3 high = cellOf(glm::max(corners[0], glm::max(corners[1], corners[2])));
+            for (int x = low.x; x <= high.x; ++x)
+                for (int y = low.y; y <= high.y; ++y)
+                    for (int z = low.z; z <= high.z; ++z)
+                        f(t, index(x, y, z));
+        }
+    }
+
+    const std::vector<glm::vec3> &triangles;
+    glm::vec3 origin;
+    float cellSize;
+    glm::ivec3 resolution;
+    std::vector<int> cellStart;
+    std::vector<int> cellTriangles;
+    std::vector<int> visited; // Last query that measured each triangle
+    int stamp;
+};
+
+// Largest distance from the samples to the surface in grid
+float sampledDistance(const std::vector<glm::vec3> &samples, TriangleGrid &grid)
+{
+    float distance = 0.0f;
+    for (const glm::vec3 &sample : samples)
+        distance = std::max(distance, grid.distance(sample));
+    return distance;
+}
+
+// Sampled Hausdorff distance between the original mesh and the LOD, relative to the diagonal of its bounding box.
+// The samples of each mesh are compared with the closest triangle of the other one, so that features that collapsed
+// to an edge or a point count as far as they are from what is left. The original mesh is sampled at its vertices,
+// which are dense, and the LOD at its vertices and the centroids of its large triangles. A LOD without any triangle
+// measures how far the vertices moved instead.
+float measureError(const TriangleMesh &originalMesh, const std::unordered_map<int, int> &originalToSimplifiedIndex, const std::vector<glm::vec3> &simplifiedVertices)
+{
+    TRACE_SCOPE("measureError");
+    std::vector<glm::vec3> originalTriangles;
+    std::vector<glm::ivec3> simplifiedFaces;
+    std::unordered_set<glm::ivec3> simplifiedFaceSet;
+    for (int i = 0; i < originalMesh.triangles.size(); i += 3)
+    {
+        glm::vec3 original[3], simplified[3];
+        int j[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            int vertex = originalMesh.triangles[i + k];
+            j[k] = originalToSimplifiedIndex.find(vertex)->second;
+            original[k] = originalMesh.vertices[vertex];
+            simplified[k] = simplifiedVertices[j[k]];
+        }
+        if (!isDegenerate(original)) originalTriangles.insert(originalTriangles.end(), original, original + 3);
+
+        // Many original triangles become the same one, which is measured once
+        if (isDegenerate(simplified)) continue;
+        int first = std::min_element(j, j + 3) - j;
+        glm::ivec3 face(j[first], j[(first + 1) % 3], j[(first + 2) % 3]);
+        if (simplifiedFaceSet.insert(face).second) simplifiedFaces.push_back(face);
+    }
+
+    float error = 0.0f;
+    if (originalTriangles.empty() || simplifiedFaces.empty())
+    {
+        for (const auto &vertex : originalToSimplifiedIndex)
+            error = std::max(error, glm::length(originalMesh.vertices[vertex.first] - simplifiedVertices[vertex.second]));
+        return error / std::max(glm::length(originalMesh.aabb.max - originalMesh.aabb.min), 1e-6f);
+    }
+
+    // Only the vertices of the remaining triangles are on the surface of the LOD
+    std::vector<glm::vec3> simplifiedTriangles, simplifiedSamples;
+    std::vector<bool> used(simplifiedVertices.size(), false);
+    for (const glm::ivec3 &face : simplifiedFaces)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            simplifiedTriangles.push_back(simplifiedVertices[face[k]]);
+            if (!used[face[k]]) simplifiedSamples.push_back(simplifiedVertices[face[k]]);
+            used[face[k]] = true;
+        }
+    }
+    for (size_t i = 0; i < simplifiedTriangles.size(); i += 3)
+        simplifiedSamples.push_back((simplifiedTriangles[i] + simplifiedTriangles[i + 1] + simplifiedTriangles[i + 2]) / 3.0f);
+
+    TriangleGrid originalGrid(originalTriangles), simplifiedGrid(simplifiedTriangles);
+    error = std::max(sampledDistance(originalMesh.vertices, simplifiedGrid), sampledDistance(simplifiedSamples, originalGrid));
+    return error / std::max(glm::length(originalMesh.aabb.max - originalMesh.aabb.min), 1e-6f);
+}
+
+// Returns the error of the LOD, as given by measureError
+template <typename Output>
+float ObtainQuadricErrorMethodLOD(const TriangleMesh &mesh, const std::vector<OctreeNode*> &representative, Output &simplifiedMesh)
 {
-    TriangleMesh simplifiedMesh;
     std::unordered_map<int, int> originalToSimplifiedIndex;
-    addVertices(mesh, simplifiedMesh, originalToSimplifiedIndex, representative, true);
+    std::vector<glm::vec3> simplifiedVertices;
+    addVertices(mesh, simplifiedMesh, originalToSimplifiedIndex, simplifiedVertices, representative, true);
     addFaces(mesh, simplifiedMesh, originalToSimplifiedIndex);
-    return simplifiedMesh;
+    return measureError(mesh, originalToSimplifiedIndex, simplifiedVertices);
 }
 
-TriangleMesh ObtainAverageLOD(const TriangleMesh &mesh, const std::vector<OctreeNode*> &representative)
+template <typename Output>
+float ObtainAverageLOD(const TriangleMesh &mesh, const std::vector<OctreeNode*> &representative, Output &simplifiedMesh)
 {
-    TriangleMesh simplifiedMesh;
     std::unordered_map<int, int> originalToSimplifiedIndex;
-    addVertices(mesh, simplifiedMesh, originalToSimplifiedIndex, representative, false);
+    std::vector<glm::vec3> simplifiedVertices;
+    addVertices(mesh, simplifiedMesh, originalToSimplifiedIndex, simplifiedVertices, representative, false);
     addFaces(mesh, simplifiedMesh, originalToSimplifiedIndex);
-    return simplifiedMesh;
+    return measureError(mesh, originalToSimplifiedIndex, simplifiedVertices);
 }
 
-std::vector<TriangleMesh> SimplifyMesh(const TriangleMesh &mesh, SimplificationMethod method, int max_depth, int lods)
+template <typename Output>
+float ObtainLOD(const TriangleMesh &mesh, const std::vector<OctreeNode*> &representative, SimplificationMethod method, Output &simplifiedMesh)
 {
+    switch (method)
+    {
+        case QEM:
+            return ObtainQuadricErrorMethodLOD(mesh, representative, simplifiedMesh);
+
+        default:
+            std::cerr << "E: Unknown simplification method, 'mean' method selected" << std::endl;
+            // Intentional fallthrough
+        case MEAN:
+            return ObtainAverageLOD(mesh, representative, simplifiedMesh);
+    }
+}
+
+// Clusters the vertices in the octree and calls obtainLOD with the representatives of each LOD, from finer to coarser
+void SimplifyMesh(const TriangleMesh &mesh, SimplificationMethod method, int max_depth, int lods,
+                  const std::function<void(int, const std::vector<OctreeNode*> &)> &obtainLOD)
+{
+    TRACE_SCOPE("SimplifyMesh");
     Octree octree(mesh.aabb, max_depth);
     std::vector<OctreeNode*> representative(mesh.vertices.size(), nullptr);
 
-    if (method == QEM) computeRepresentativesByCorners(mesh, octree, representative);
-    else computeRepresentativesByVertices(mesh, octree, representative);
+    {
+        TRACE_SCOPE("Octree build");
+        if (method == QEM) computeRepresentativesByCorners(mesh, octree, representative);
+        else computeRepresentativesByVertices(mesh, octree, representative);
+    }
 
-    std::vector<TriangleMesh> LOD;
     for (int l = 0; l < lods; ++l)
     {
-        switch (method)
-        {
-            case QEM:
-                LOD.push_back(ObtainQuadricErrorMethodLOD(mesh, representative));
-                break;
-
-            default:
-                std::cerr << "E: Unknown simplification method, 'mean' method selected" << std::endl;
-                // Intentional fallthrough
-            case MEAN:
-                LOD.push_back(ObtainAverageLOD(mesh, representative));
-                break;
-        }
+        TRACE_SCOPE("LOD");
+        obtainLOD(l, representative);
         for (int i = 0; i < mesh.vertices.size(); ++i)
         {
             representative[i] = representative[i]->parent;
         }
     }
+}
+
+// errors receives the error of each LOD, as given by measureError
+std::vector<TriangleMesh> SimplifyMesh(const TriangleMesh &mesh, SimplificationMethod method, int max_depth, int lods, std::vector<float> &errors)
+{
+    std::vector<TriangleMesh> LOD(lods);
+    errors.resize(lods);
+    SimplifyMesh(mesh, method, max_depth, lods, [&](int l, const std::vector<OctreeNode*> &representative)
+    {
+        errors[l] = ObtainLOD(mesh, representative, method, LOD[l]);
+    });
     return LOD;
 }
 
+LodInfo DescribeLOD(int nTriangles, int nVertices, int depth, float error)
+{
+    return {nTriangles, nVertices, depth, error};
+}
+
+bool WriteMetadata(const std::vector<LodInfo> &info)
+{
+    if (LodMetadata::write(LOD_METADATA_FILENAME, info)) return true;
+    std::cerr << "Failed to write " + LOD_METADATA_FILENAME << std::endl;
+    return false;
+}
+
+// Streams every LOD to its *.ply file without keeping it in memory
+bool SimplifyMeshToFiles(const TriangleMesh &mesh, SimplificationMethod method, int max_depth, int lods)
+{
+    bool written = true;
+    std::vector<LodInfo> info(lods);
+    SimplifyMesh(mesh, method, max_depth, lods, [&](int l, const std::vector<OctreeNode*> &representative)
+    {
+        PLYWriter writer;
+        std::string filename = std::to_string(lods - l - 1) + ".ply";
+        if (writer.begin(filename))
+        {
+            float error = ObtainLOD(mesh, representative, method, writer);
+            info[lods - l - 1] = DescribeLOD(writer.getFaceCount(), writer.getVertexCount(), max_depth - l, error);
+            if (writer.finalize()) return;
+        }
+        std::cerr << "Failed to write " + filename << std::endl;
+        written = false;
+    });
+    return written && WriteMetadata(info);
+}
+
 const std::string DEFAULT_MESH = "models/bunny.ply";
 
 const SimplificationMethod DEFAULT_METHOD = MEAN;
@@ -187,6 +476,8 @@ const int DEFAULT_MAX_DEPTH = 8;
 const int MIN_LODS = 1;
 const int DEFAULT_LODS = 4;
 
+const std::string TRACE_FILENAME = "simplifier_trace.json";
+
 int main(int argc, char **argv)
 {
     std::string mesh_filename = DEFAULT_MESH;
@@ -235,12 +526,45 @@ int main(int argc, char **argv)
         }
     }
 
+    bool bundle = false;
+    if (argc > 5)
+    {
+        std::string input_output = std::string(argv[5]);
+        if (input_output == "bundle") bundle = true;
+        else
+        {
+            std::cerr << "W: Unknown output '" << input_output << "'." << std::endl;
+            std::cerr << "W: Only 'bundle' is available, writing the *.ply files alone" << std::endl;
+        }
+    }
+
     TriangleMesh mesh;
     if (PLYReader::readMesh(mesh_filename, mesh))
     {
-        std::vector<TriangleMesh> LOD = SimplifyMesh(mesh, method, max_depth, lods);
-        for (int i = 0; i < lods; ++i)
-            PLYWriter::writeMesh(std::to_string(lods - i - 1) + ".ply", LOD[i]);
+        if (bundle)
+        {
+            std::vector<float> errors;
+            std::vector<TriangleMesh> LOD = SimplifyMesh(mesh, method, max_depth, lods, errors);
+            std::vector<LodInfo> info(lods);
+            for (int i = 0; i < lods; ++i)
+            {
+                PLYWriter::writeMesh(std::to_string(lods - i - 1) + ".ply", LOD[i]);
+                info[lods - i - 1] = DescribeLOD(LOD[i].triangles.size() / 3, LOD[i].vertices.size(), max_depth - i, errors[i]);
+            }
+            if (!WriteMetadata(info)) return -1;
+
+            // Rescale each LOD the same way reading back its *.ply file would
+            std::vector<TriangleMesh> bundleLOD(LOD.rbegin(), LOD.rend());
+            for (TriangleMesh &lod : bundleLOD)
+                lod.aabb = PLYReader::rescaleModel(lod.vertices);
+            if (!LodBundle::write(LOD_BUNDLE_FILENAME, bundleLOD))
+            {
+                std::cerr << "Failed to write " + LOD_BUNDLE_FILENAME << std::endl;
+                return -1;
+            }
+        }
+        else if (!SimplifyMeshToFiles(mesh, method, max_depth, lods)) return -1;
+        TRACE_WRITE(TRACE_FILENAME);
     }
     else
     {
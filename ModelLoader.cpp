@@ -0,0 +1,114 @@
+#include "ModelLoader.h"
+#include "PLYReader.h"
+#include "Trace.h"
+
+#include <chrono>
+
+const float *LoadedLod::getVertexData() const
+{
+    return bundle ? bundle->getVertexData(lod) : vertexData.data();
+}
+
+const int *LoadedLod::getIndices() const
+{
+    return bundle ? bundle->getIndices(lod) : indices.data();
+}
+
+ModelLoader::ModelLoader(unsigned int threads)
+    : pending(0)
+    , pool(threads)
+{
+}
+
+void ModelLoader::request(int model, int lod, const std::string &directory)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++pending;
+    }
+    pool.submit([this, model, lod, directory]() { prepare(model, lod, directory); });
+}
+
+bool ModelLoader::poll(LoadedLod &lod)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (queue.empty())
+        return false;
+    lod = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
+
+bool ModelLoader::wait(LoadedLod &lod)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    completed.wait(lock, [this]() { return !queue.empty() || pending == 0; });
+    if (queue.empty())
+        return false;
+    lod = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
+
+void ModelLoader::stop()
+{
+    pool.stop();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = 0;
+    }
+    completed.notify_all();
+}
+
+int ModelLoader::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+unsigned int ModelLoader::getThreadCount() const
+{
+    return pool.getThreadCount();
+}
+
+void ModelLoader::prepare(int model, int lod, const std::string &directory)
+{
+    TRACE_SCOPE("ModelLoader::prepare");
+    auto start = std::chrono::steady_clock::now();
+    LoadedLod result;
+    result.model = model;
+    result.lod = lod;
+
+    auto bundle = std::make_shared<LodBundle>();
+    if (bundle->open(directory + "/" + LOD_BUNDLE_FILENAME) && lod < bundle->getLodCount())
+    {
+        result.loaded = bundle->checkIndices(lod);
+        result.mesh.aabb = bundle->getAABB(lod);
+        result.nTriangles = bundle->getTriangleCount(lod);
+        result.nVertices = bundle->getVertexCount(lod);
+        result.bundle = bundle;
+        if (result.loaded)
+            result.stats = VertexCache::measure(result.getIndices(), result.nTriangles, result.nVertices);
+        result.originalStats = result.stats;
+    }
+    else
+    {
+        // Workers already run in parallel, so each of them decodes its faces alone
+        std::string meshFilename = directory + "/" + std::to_string(lod) + ".ply";
+        TriangleMesh &mesh = result.mesh;
+        result.loaded = PLYReader::readMesh(meshFilename, mesh, 1);
+        result.originalStats = VertexCache::measure(mesh.triangles.data(), mesh.triangles.size() / 3, mesh.vertices.size());
+        mesh.buildIndexedData(result.vertexData, result.indices);
+        result.nTriangles = result.indices.size() / 3;
+        result.nVertices = result.vertexData.size() / 6;
+        result.stats = VertexCache::measure(result.indices.data(), result.nTriangles, result.nVertices);
+    }
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(result));
+        --pending;
+    }
+    completed.notify_all();
+}
@@ -0,0 +1,74 @@
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include "LodBundle.h"
+#include "ThreadPool.h"
+#include "TriangleMesh.h"
+#include "VertexCache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A LOD read and prepared on a worker thread, ready to be uploaded from the GL thread
+struct LoadedLod
+{
+    int model;
+    int lod;
+    bool loaded;
+    TriangleMesh mesh;                 // AABB, plus vertices and triangles when read from a *.ply file
+    int nTriangles;
+    int nVertices;
+    std::vector<float> vertexData;     // Vertex data built from the *.ply file
+    std::vector<int> indices;          // Indices built from the *.ply file
+    std::shared_ptr<LodBundle> bundle; // Bundle mapping the vertex data and indices otherwise
+    VertexCacheStats originalStats;    // Of the triangles as stored in the *.ply file, same as stats for bundles
+    VertexCacheStats stats;            // Of the indices sent to OpenGL
+    double milliseconds;               // Time spent reading and preparing it
+
+    const float *getVertexData() const;
+    const int *getIndices() const;
+};
+
+// ModelLoader reads LODs (from the model's LOD bundle if it has one, from its
+// *.ply files otherwise) and builds their vertex data on a pool of worker
+// threads. Prepared LODs are handed back through a completion queue, so that
+// the OpenGL buffers can be created on the thread that owns the context.
+
+class ModelLoader
+{
+
+public:
+    // 0 threads uses one per core
+    ModelLoader(unsigned int threads = 0);
+
+    // Queues preparing the given LOD of the model stored in directory
+    void request(int model, int lod, const std::string &directory);
+
+    // Pops a prepared LOD without blocking, false if none is ready
+    bool poll(LoadedLod &lod);
+
+    // Blocks until a LOD is prepared, false if none is pending
+    bool wait(LoadedLod &lod);
+
+    // Waits for the LODs being prepared and drops the queued ones, nothing can be requested afterwards
+    void stop();
+
+    int getPendingCount() const;
+    unsigned int getThreadCount() const;
+
+private:
+    void prepare(int model, int lod, const std::string &directory);
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable completed;
+    std::deque<LoadedLod> queue;
+    int pending;
+    ThreadPool pool; // Declared last so that workers stop before the queue is destroyed
+};
+
+#endif // MODELLOADER_H
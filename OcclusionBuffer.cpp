@@ -0,0 +1,187 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Twice the signed area of the triangle (a, b, p), positive when counter clockwise
+static float edge(const glm::vec2 &a, const glm::vec2 &b, const glm::vec2 &p)
+{
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+OcclusionBuffer::OcclusionBuffer()
+{
+    width = 0;
+    height = 0;
+    tilesX = 0;
+    tilesY = 0;
+    viewProjection = glm::mat4(1.0f);
+    resize(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+}
+
+void OcclusionBuffer::resize(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    tilesX = (width + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+    tilesY = (height + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+    depth.assign(width * height, 1.0f);
+    tileDepth.assign(tilesX * tilesY, 1.0f);
+}
+
+void OcclusionBuffer::clear(const glm::mat4 &viewProjection)
+{
+    this->viewProjection = viewProjection;
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    std::fill(tileDepth.begin(), tileDepth.end(), 1.0f);
+}
+
+void OcclusionBuffer::rasterize(const std::vector<glm::vec3> &triangles)
+{
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3)
+    {
+        // Clip against the near plane (z >= -w), which leaves at most 4 corners
+        glm::vec4 corners[3];
+        for (int i = 0; i < 3; ++i)
+            corners[i] = viewProjection * glm::vec4(triangles[t + i], 1.0f);
+
+        glm::vec4 clipped[4];
+        int nClipped = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const glm::vec4 &current = corners[i];
+            const glm::vec4 &next = corners[(i + 1) % 3];
+            float dCurrent = current.z + current.w;
+            float dNext = next.z + next.w;
+            if (dCurrent >= 0.0f)
+                clipped[nClipped++] = current;
+            if ((dCurrent >= 0.0f) != (dNext >= 0.0f))
+                clipped[nClipped++] = glm::mix(current, next, dCurrent / (dCurrent - dNext));
+        }
+        if (nClipped < 3)
+            continue;
+
+        // Window coordinates, with y pointing up as in OpenGL
+        glm::vec3 window[4];
+        for (int i = 0; i < nClipped; ++i)
+        {
+            glm::vec3 ndc = glm::vec3(clipped[i]) / clipped[i].w;
+            window[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+        }
+        for (int i = 2; i < nClipped; ++i)
+            rasterizeTriangle(window[0], window[i - 1], window[i]);
+    }
+}
+
+void OcclusionBuffer::rasterizeTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+    // Back facing and degenerate triangles can't hide anything a front facing one doesn't
+    float area = edge(a, b, c);
+    if (area <= 0.0f)
+        return;
+
+    // Pixels whose center lies in the bounding rectangle
+    int x0 = std::max(0, int(std::ceil(std::min({a.x, b.x, c.x}) - 0.5f)));
+    int x1 = std::min(width - 1, int(std::floor(std::max({a.x, b.x, c.x}) - 0.5f)));
+    int y0 = std::max(0, int(std::ceil(std::min({a.y, b.y, c.y}) - 0.5f)));
+    int y1 = std::min(height - 1, int(std::floor(std::max({a.y, b.y, c.y}) - 0.5f)));
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            glm::vec2 p(x + 0.5f, y + 0.5f);
+            float wa = edge(b, c, p);
+            float wb = edge(c, a, p);
+            float wc = edge(a, b, p);
+            if (wa < 0.0f || wb < 0.0f || wc < 0.0f)
+                continue;
+
+            float z = (wa * a.z + wb * b.z + wc * c.z) / area;
+            float &stored = depth[y * width + x];
+            stored = std::min(stored, z);
+        }
+    }
+}
+
+void OcclusionBuffer::updateTiles()
+{
+    std::fill(tileDepth.begin(), tileDepth.end(), 0.0f);
+    for (int y = 0; y < height; ++y)
+    {
+        float *tileRow = &tileDepth[(y / OCCLUSION_TILE_SIZE) * tilesX];
+        for (int x = 0; x < width; ++x)
+        {
+            float &farthest = tileRow[x / OCCLUSION_TILE_SIZE];
+            farthest = std::max(farthest, depth[y * width + x]);
+        }
+    }
+}
+
+bool OcclusionBuffer::isVisible(const AABB &aabb) const
+{
+    // Screen rectangle and nearest depth of the box
+    glm::vec2 low(std::numeric_limits<float>::max());
+    glm::vec2 high(-std::numeric_limits<float>::max());
+    float nearest = 1.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner((i & 1) ? aabb.max.x : aabb.min.x, (i & 2) ? aabb.max.y : aabb.min.y, (i & 4) ? aabb.max.z : aabb.min.z);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+        // Boxes crossing the near plane are too close to be hidden
+        if (clip.z < -clip.w)
+            return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 window((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height);
+        low = glm::min(low, window);
+        high = glm::max(high, window);
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Every pixel the rectangle touches, even partially
+    int x0 = std::max(0, int(std::floor(low.x)));
+    int x1 = std::min(width - 1, int(std::floor(high.x)));
+    int y0 = std::max(0, int(std::floor(low.y)));
+    int y1 = std::min(height - 1, int(std::floor(high.y)));
+    if (x0 > x1 || y0 > y1)
+        return false;
+
+    for (int ty = y0 / OCCLUSION_TILE_SIZE; ty <= y1 / OCCLUSION_TILE_SIZE; ++ty)
+    {
+        for (int tx = x0 / OCCLUSION_TILE_SIZE; tx <= x1 / OCCLUSION_TILE_SIZE; ++tx)
+        {
+            if (tileDepth[ty * tilesX + tx] < nearest)
+                continue;
+
+            int pixelY1 = std::min(y1, (ty + 1) * OCCLUSION_TILE_SIZE - 1);
+            int pixelX1 = std::min(x1, (tx + 1) * OCCLUSION_TILE_SIZE - 1);
+            for (int y = std::max(y0, ty * OCCLUSION_TILE_SIZE); y <= pixelY1; ++y)
+            {
+                for (int x = std::max(x0, tx * OCCLUSION_TILE_SIZE); x <= pixelX1; ++x)
+                {
+                    if (depth[y * width + x] >= nearest)
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+int OcclusionBuffer::getWidth() const
+{
+    return width;
+}
+
+int OcclusionBuffer::getHeight() const
+{
+    return height;
+}
+
+const std::vector<float> &OcclusionBuffer::getDepth() const
+{
+    return depth;
+}
@@ -0,0 +1,61 @@
+#ifndef OCCLUSIONBUFFER_H
+#define OCCLUSIONBUFFER_H
+
+#include "AABB.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Default resolution of the occlusion buffer, much lower than the screen
+constexpr int OCCLUSION_WIDTH = 256;
+constexpr int OCCLUSION_HEIGHT = 128;
+
+// Pixels along each side of the tiles that keep the farthest depth under them
+constexpr int OCCLUSION_TILE_SIZE = 8;
+
+// OcclusionBuffer is a small depth buffer rasterized on the CPU. Occluders
+// are drawn into it every frame, and bounding boxes are then tested against
+// it: a box is hidden if its nearest depth is behind the occluders in every
+// pixel its screen rectangle covers. A second level keeps the farthest depth
+// of each tile of pixels, so that most hidden boxes are rejected without
+// looking at single pixels. It doesn't use OpenGL at all.
+
+class OcclusionBuffer
+{
+
+public:
+    OcclusionBuffer();
+
+    void resize(int width, int height);
+
+    // Empties the buffer, occluders and boxes are then projected with the matrix
+    void clear(const glm::mat4 &viewProjection);
+
+    // triangles holds 3 corners per triangle, counter clockwise when front facing
+    void rasterize(const std::vector<glm::vec3> &triangles);
+
+    // Must be called after the occluders are rasterized and before testing boxes
+    void updateTiles();
+
+    // False only if the box is certainly hidden by the occluders
+    bool isVisible(const AABB &aabb) const;
+
+    int getWidth() const;
+    int getHeight() const;
+    const std::vector<float> &getDepth() const;
+
+private:
+    void rasterizeTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+
+private:
+    int width;
+    int height;
+    int tilesX;
+    int tilesY;
+    glm::mat4 viewProjection;
+    std::vector<float> depth; // Window depth in [0, 1], 1 where nothing was drawn
+    std::vector<float> tileDepth; // Farthest depth of each tile
+};
+
+#endif // OCCLUSIONBUFFER_H
@@ -0,0 +1,182 @@
+#include "BenchCommon.h"
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Checks the CPU occlusion buffer on a few boxes whose answer is known, and
+// then times it, without a window, over synthetic museums: a grid of rooms of
+// ROOM_SIZE x ROOM_SIZE cells with a doorway in the middle of every wall, a
+// statue box in some of the cells, and a camera walking a circle through them
+// while it looks around. Every wall face is an occluder, as if all the wall
+// tiles were in the view.
+
+using Clock = std::chrono::steady_clock;
+
+const int ROOM_SIZE = 8;
+const int CELLS_PER_STATUE = 4;
+
+const int DEFAULT_FRAMES = 500;
+const int DEFAULT_ROOMS = 8; // Along each side of the museum
+
+static float elapsed(Clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+// Two triangles, counter clockwise when seen from the side normal points to
+void addQuad(std::vector<glm::vec3> &triangles, const glm::vec3 &origin, const glm::vec3 &u, const glm::vec3 &v)
+{
+    triangles.insert(triangles.end(), {origin, origin + u, origin + u + v, origin, origin + u + v, origin + v});
+}
+
+// The camera is at (0, 0.5, 0) looking down -z, and a 2 x 1 wall stands 2 units in front of it
+bool checkKnownBoxes()
+{
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), float(OCCLUSION_WIDTH) / OCCLUSION_HEIGHT, 0.01f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 0.5f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<glm::vec3> wall;
+    addQuad(wall, glm::vec3(-1.0f, 0.0f, -2.0f), glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    OcclusionBuffer occlusion;
+    occlusion.clear(projection * view);
+    occlusion.rasterize(wall);
+    occlusion.updateTiles();
+
+    struct Check
+    {
+        const char *name;
+        AABB aabb;
+        bool visible;
+    };
+    const Check checks[] = {
+        {"Box behind the wall", AABB(glm::vec3(-0.3f, 0.2f, -3.5f), glm::vec3(0.3f, 0.8f, -3.0f)), false},
+        {"Box beside the wall", AABB(glm::vec3(2.0f, 0.2f, -3.5f), glm::vec3(2.6f, 0.8f, -3.0f)), true},
+        {"Box crossing the near plane", AABB(glm::vec3(-0.3f, 0.2f, -3.0f), glm::vec3(0.3f, 0.8f, 0.5f)), true},
+    };
+
+    bool passed = true;
+    for (const Check &check : checks)
+    {
+        bool visible = occlusion.isVisible(check.aabb);
+        std::cout << "\t" << check.name << ": " << (visible ? "visible" : "hidden") << (visible == check.visible ? "" : " (WRONG)") << std::endl;
+        passed = passed && visible == check.visible;
+    }
+    return passed;
+}
+
+// A wall on every room boundary, with a face on each side
+std::vector<glm::vec3> syntheticWalls(int nRooms)
+{
+    std::vector<glm::vec3> triangles;
+    glm::vec3 up(0.0f, 1.0f, 0.0f);
+    for (int line = 0; line <= nRooms; ++line)
+    {
+        float offset = float(line * ROOM_SIZE);
+        for (int room = 0; room < nRooms; ++room)
+        {
+            // Two segments with a doorway of one cell between them
+            float start = float(room * ROOM_SIZE);
+            float door = start + ROOM_SIZE / 2;
+            float segments[2][2] = {{start, door}, {door + 1.0f, start + ROOM_SIZE}};
+            for (const float *segment : segments)
+            {
+                float length = segment[1] - segment[0];
+                // Walls along x, facing -z and +z
+                addQuad(triangles, glm::vec3(segment[1], 0.0f, offset), glm::vec3(-length, 0.0f, 0.0f), up);
+                addQuad(triangles, glm::vec3(segment[0], 0.0f, offset), glm::vec3(length, 0.0f, 0.0f), up);
+                // Walls along z, facing +x and -x
+                addQuad(triangles, glm::vec3(offset, 0.0f, segment[1]), glm::vec3(0.0f, 0.0f, -length), up);
+                addQuad(triangles, glm::vec3(offset, 0.0f, segment[0]), glm::vec3(0.0f, 0.0f, length), up);
+            }
+        }
+    }
+    return triangles;
+}
+
+std::vector<AABB> syntheticStatues(int nRooms)
+{
+    int size = nRooms * ROOM_SIZE;
+    std::mt19937 random(nRooms);
+    std::vector<AABB> statues;
+    for (int x = 0; x < size; ++x)
+    {
+        for (int y = 0; y < size; ++y)
+        {
+            if (random() % CELLS_PER_STATUE != 0)
+                continue;
+            glm::vec3 center(x + 0.5f, 0.0f, y + 0.5f);
+            statues.push_back(AABB(center + glm::vec3(-0.3f, 0.0f, -0.3f), center + glm::vec3(0.3f, 0.8f, 0.3f)));
+        }
+    }
+    return statues;
+}
+
+void runFrames(int nRooms, int frames)
+{
+    std::vector<glm::vec3> walls = syntheticWalls(nRooms);
+    std::vector<AABB> statues = syntheticStatues(nRooms);
+    std::cout << nRooms << " x " << nRooms << " rooms, " << walls.size() / 3 << " occluder triangles, " << statues.size() << " statues, " << frames << " frames" << std::endl;
+
+    glm::mat4 projection = benchProjection();
+
+    OcclusionBuffer occlusion;
+    StageTimes rasterize = {0.0, 0.0f}, tiles = {0.0, 0.0f}, tests = {0.0, 0.0f};
+    double totalHidden = 0.0;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        BenchCamera camera = walkCircle(frame, frames, float(nRooms * ROOM_SIZE));
+
+        Clock::time_point start = Clock::now();
+        occlusion.clear(projection * camera.view);
+        occlusion.rasterize(walls);
+        rasterize.add(elapsed(start));
+
+        start = Clock::now();
+        occlusion.updateTiles();
+        tiles.add(elapsed(start));
+
+        start = Clock::now();
+        int hidden = 0;
+        for (const AABB &aabb : statues)
+            hidden += !occlusion.isVisible(aabb);
+        tests.add(elapsed(start));
+        totalHidden += hidden;
+    }
+
+    std::cout << "\t" << totalHidden / frames << " statues hidden per frame" << std::endl;
+    printStage("Rasterize: ", rasterize, frames);
+    printStage("Tiles:     ", tiles, frames);
+    printStage("Tests:     ", tests, frames);
+}
+
+int main(int argc, char **argv)
+{
+    int nRooms = DEFAULT_ROOMS;
+    if (argc > 1)
+    {
+        nRooms = std::max(1, std::atoi(argv[1]));
+    }
+
+    int frames = DEFAULT_FRAMES;
+    if (argc > 2)
+    {
+        frames = std::max(1, std::atoi(argv[2]));
+    }
+
+    std::cout << "Known boxes:" << std::endl;
+    if (!checkKnownBoxes())
+    {
+        std::cerr << "The occlusion buffer gave a wrong answer" << std::endl;
+        return -1;
+    }
+
+    runFrames(nRooms, frames);
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "OcclusionQueries.h"
+
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+
+// Boxes closer than this to the viewpoint may cross the near plane, so they aren't queried
+constexpr float NEAR_MARGIN = 0.1f;
+
+OcclusionQueries::OcclusionQueries()
+{
+    arena = nullptr;
+    frame = 0;
+    issued = 0;
+}
+
+void OcclusionQueries::init(GeometryArena &arena, int nObjects)
+{
+    this->arena = &arena;
+    box.buildCube();
+    box.sendToOpenGL(arena);
+    box.freeGeometry();
+    boxInstances.init();
+    entries.assign(nObjects, {true, false, 0, -1});
+    frame = 0;
+}
+
+void OcclusionQueries::free()
+{
+    for (const Query &query : pending)
+        glDeleteQueries(1, &query.id);
+    if (!freeIds.empty())
+        glDeleteQueries(freeIds.size(), freeIds.data());
+    pending.clear();
+    freeIds.clear();
+    box.free();
+    boxInstances.free();
+    entries.clear();
+}
+
+void OcclusionQueries::collectResults()
+{
+    ++frame;
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < pending.size(); ++i)
+    {
+        Query &query = pending[i];
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            pending[kept++] = std::move(query);
+            continue;
+        }
+
+        GLuint passed = GL_FALSE;
+        glGetQueryObjectuiv(query.id, GL_QUERY_RESULT, &passed);
+        for (int object : query.objects)
+        {
+            // Spreading the next queries of visible objects avoids querying them all in the same frame
+            Entry &entry = entries[object];
+            entry.visible = passed != GL_FALSE;
+            entry.pending = false;
+            entry.nextQuery = entry.visible ? frame + 1 + std::rand() % VISIBLE_QUERY_INTERVAL : frame;
+        }
+        freeIds.push_back(query.id);
+    }
+    pending.resize(kept);
+}
+
+void OcclusionQueries::issueQueries(const std::vector<int> &objects, const std::vector<AABB> &boxes, const glm::vec3 &viewpoint)
+{
+    // Visible objects are queried on their own, hidden ones in groups after them
+    std::vector<int> single, grouped;
+    boxInstances.clear();
+    for (unsigned int i = 0; i < objects.size(); ++i)
+    {
+        Entry &entry = entries[objects[i]];
+        if (entry.lastTested != frame - 1)
+        {
+            entry.visible = true;
+            entry.nextQuery = frame;
+        }
+        entry.lastTested = frame;
+
+        const AABB &aabb = boxes[i];
+        if (glm::all(glm::greaterThan(viewpoint, aabb.min - NEAR_MARGIN)) && glm::all(glm::lessThan(viewpoint, aabb.max + NEAR_MARGIN)))
+        {
+            entry.visible = true;
+            continue;
+        }
+        if (entry.pending || (entry.visible && entry.nextQuery > frame))
+            continue;
+        (entry.visible ? single : grouped).push_back(i);
+    }
+    issued = 0;
+    if (single.empty() && grouped.empty())
+        return;
+
+    for (const std::vector<int> *list : {&single, &grouped})
+    {
+        for (int i : *list)
+        {
+            const AABB &aabb = boxes[i];
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), 0.5f * (aabb.min + aabb.max));
+            boxInstances.add(glm::scale(model, aabb.max - aabb.min), glm::vec4(1.0f));
+        }
+    }
+    boxInstances.upload();
+    arena->bind();
+    if (GLEW_ARB_base_instance)
+        boxInstances.bind(0);
+
+    // Boxes must not hide each other, nor anything drawn after them
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    int first = 0;
+    for (unsigned int i = 0; i < single.size() + grouped.size(); )
+    {
+        int count = i < single.size() ? 1 : std::min<int>(MULTIQUERY_SIZE, single.size() + grouped.size() - i);
+        Query query;
+        if (freeIds.empty())
+        {
+            query.id = 0;
+            glGenQueries(1, &query.id);
+        }
+        else
+        {
+            query.id = freeIds.back();
+            freeIds.pop_back();
+        }
+        for (int k = 0; k < count; ++k)
+        {
+            int object = objects[i + k < single.size() ? single[i + k] : grouped[i + k - single.size()]];
+            query.objects.push_back(object);
+            entries[object].pending = true;
+        }
+
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, query.id);
+        drawBoxes(first, count);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        pending.push_back(std::move(query));
+
+        first += count;
+        i += count;
+        ++issued;
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+}
+
+bool OcclusionQueries::isVisible(int object) const
+{
+    const Entry &entry = entries[object];
+    return entry.visible || entry.lastTested != frame;
+}
+
+int OcclusionQueries::getIssuedCount() const
+{
+    return issued;
+}
+
+int OcclusionQueries::getPendingCount() const
+{
+    return pending.size();
+}
+
+void OcclusionQueries::drawBoxes(int first, int count) const
+{
+    const ArenaRange &range = box.getArenaRange();
+    void *firstIndex = (void *)(range.firstIndex * sizeof(GLuint));
+    if (GLEW_ARB_base_instance)
+    {
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, range.nIndices, GL_UNSIGNED_INT, firstIndex,
+                                                      count, range.baseVertex, first);
+    }
+    else
+    {
+        boxInstances.bind(first);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.nIndices, GL_UNSIGNED_INT, firstIndex, count, range.baseVertex);
+    }
+}
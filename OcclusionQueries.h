@@ -0,0 +1,80 @@
+#ifndef OCCLUSIONQUERIES_H
+#define OCCLUSIONQUERIES_H
+
+#include "AABB.h"
+#include "GeometryArena.h"
+#include "InstanceBuffer.h"
+#include "TriangleMesh.h"
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Frames a visible object is assumed to stay visible, at most, before it is queried again
+constexpr int VISIBLE_QUERY_INTERVAL = 8;
+
+// Hidden objects tested together by a single query
+constexpr int MULTIQUERY_SIZE = 8;
+
+// OcclusionQueries tests the bounding boxes of objects against the depth
+// buffer with hardware occlusion queries, hiding their latency with temporal
+// coherence as in CHC++. The visibility of an object is the result of its
+// last finished query, and results are only read once they are available,
+// so the CPU never waits for the GPU. Visible objects are queried again
+// after a random number of frames, hidden ones every frame but several of
+// them in a single query; when such a query passes, all of them become
+// visible until they are queried on their own.
+
+class OcclusionQueries
+{
+
+public:
+    OcclusionQueries();
+
+    // Objects are identified by an index in [0, nObjects)
+    void init(GeometryArena &arena, int nObjects);
+    void free();
+
+    // Updates the visibility of the objects whose queries have finished
+    void collectResults();
+
+    // Issues the queries due this frame for the objects, which must be drawn with the depth of the occluders bound
+    void issueQueries(const std::vector<int> &objects, const std::vector<AABB> &boxes, const glm::vec3 &viewpoint);
+
+    // Result of the last query, objects that weren't tested in the last frame are visible
+    bool isVisible(int object) const;
+
+    int getIssuedCount() const;
+    int getPendingCount() const;
+
+private:
+    struct Entry
+    {
+        bool visible;
+        bool pending; // A query for it is in flight
+        long long nextQuery; // Frame in which it is due again if it stays visible
+        long long lastTested; // Frame in which it was last passed to issueQueries
+    };
+
+    struct Query
+    {
+        GLuint id;
+        std::vector<int> objects;
+    };
+
+    void drawBoxes(int first, int count) const;
+
+private:
+    GeometryArena *arena;
+    TriangleMesh box; // Cube from -0.5 to 0.5, scaled to each bounding box
+    InstanceBuffer boxInstances;
+    std::vector<Entry> entries;
+    std::vector<Query> pending;
+    std::vector<GLuint> freeIds;
+    long long frame;
+    int issued;
+};
+
+#endif // OCCLUSIONQUERIES_H
@@ -0,0 +1,133 @@
+#include "PLYReader.h"
+#include "TriangleMesh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+
+// Compares the load time of the stream based PLY reader against the mapped one,
+// decoding the faces with a single thread and with all of them, and against the
+// out of core visitor. Checks that all of them produce the same mesh.
+
+using Reader = std::function<bool(const std::string &, TriangleMesh &)>;
+
+// Best time in milliseconds over all repetitions, negative if the file could not be read
+double timeReader(Reader reader, const std::string &filename, int repetitions, TriangleMesh &mesh)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repetitions; ++r)
+    {
+        TriangleMesh candidate;
+
+        std::cout.setstate(std::ios_base::failbit); // Silence the readers' own logging
+        auto start = std::chrono::steady_clock::now();
+        bool loaded = reader(filename, candidate);
+        auto end = std::chrono::steady_clock::now();
+        std::cout.clear();
+
+        if (!loaded) return -1.0;
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        mesh = std::move(candidate);
+    }
+    return best;
+}
+
+// Checks the blocks handed over by PLYReader::visitMesh against an already loaded mesh
+class ComparingVisitor : public PLYVisitor
+{
+
+public:
+    ComparingVisitor(const TriangleMesh &mesh) : mesh(mesh), nTriangles(0), same(true) {}
+
+    void visitHeader(int nVertices, int nFaces, const AABB &aabb) override
+    {
+        same = same && nVertices == int(mesh.vertices.size()) && aabb.min == mesh.aabb.min && aabb.max == mesh.aabb.max;
+    }
+
+    void visitVertices(int first, const glm::vec3 *vertices, int n) override
+    {
+        same = same && std::equal(vertices, vertices + n, mesh.vertices.begin() + first);
+    }
+
+    void visitTriangles(const int *indices, int n) override
+    {
+        same = same && 3 * (nTriangles + n) <= mesh.triangles.size() && std::equal(indices, indices + 3 * n, mesh.triangles.begin() + 3 * nTriangles);
+        nTriangles += n;
+    }
+
+    bool isSame() const
+    {
+        return same && 3 * nTriangles == mesh.triangles.size();
+    }
+
+private:
+    const TriangleMesh &mesh;
+    size_t nTriangles;
+    bool same;
+};
+
+bool sameMesh(const TriangleMesh &lhs, const TriangleMesh &rhs)
+{
+    return lhs.vertices == rhs.vertices && lhs.triangles == rhs.triangles &&
+           lhs.aabb.min == rhs.aabb.min && lhs.aabb.max == rhs.aabb.max;
+}
+
+const std::string DEFAULT_MESH = "models/bunny.ply";
+const int DEFAULT_REPETITIONS = 5;
+
+int main(int argc, char **argv)
+{
+    std::string mesh_filename = DEFAULT_MESH;
+    if (argc > 1)
+    {
+        mesh_filename = std::string(argv[1]);
+    }
+
+    int repetitions = DEFAULT_REPETITIONS;
+    if (argc > 2)
+    {
+        repetitions = std::max(1, std::atoi(argv[2]));
+    }
+
+    Reader serialReader = [](const std::string &filename, TriangleMesh &mesh) { return PLYReader::readMesh(filename, mesh, 1); };
+    Reader parallelReader = [](const std::string &filename, TriangleMesh &mesh) { return PLYReader::readMesh(filename, mesh); };
+
+    TriangleMesh streamed, mapped, parallel;
+    double streamedTime = timeReader(PLYReader::readMeshStreamed, mesh_filename, repetitions, streamed);
+    double mappedTime = timeReader(serialReader, mesh_filename, repetitions, mapped);
+    double parallelTime = timeReader(parallelReader, mesh_filename, repetitions, parallel);
+    if (streamedTime < 0.0 || mappedTime < 0.0 || parallelTime < 0.0)
+    {
+        std::cerr << "Failed to load " + mesh_filename << std::endl;
+        return -1;
+    }
+
+    std::cout << mesh_filename << ": " << streamed.vertices.size() << " vertices, " << streamed.triangles.size() / 3 << " triangles" << std::endl;
+    std::cout << "\tStreamed: " << streamedTime << " ms" << std::endl;
+    std::cout << "\tMapped:   " << mappedTime << " ms (" << streamedTime / mappedTime << "x)" << std::endl;
+    std::cout << "\tParallel: " << parallelTime << " ms (" << streamedTime / parallelTime << "x, "
+              << std::max(1u, std::thread::hardware_concurrency()) << " threads)" << std::endl;
+    if (!sameMesh(streamed, mapped) || !sameMesh(streamed, parallel))
+    {
+        std::cerr << "E: Mapped reader produced a different mesh" << std::endl;
+        return -1;
+    }
+
+    // Out of core reading, in blocks of the default size
+    ComparingVisitor visitor(streamed);
+    auto start = std::chrono::steady_clock::now();
+    bool visited = PLYReader::visitMesh(mesh_filename, visitor, true);
+    auto end = std::chrono::steady_clock::now();
+    if (!visited || !visitor.isSame())
+    {
+        std::cerr << "E: Streaming visitor produced a different mesh" << std::endl;
+        return -1;
+    }
+    std::cout << "\tVisitor:  " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    return 0;
+}
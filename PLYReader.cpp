@@ -1,11 +1,95 @@
 #include "PLYReader.h"
+#include "MappedFile.h"
+#include "Trace.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
-bool PLYReader::readMesh(const std::string &filename, TriangleMesh &mesh)
+// Faces per chunk when splitting the face block among threads
+constexpr int FACES_PER_CHUNK = 1 << 16;
+
+// Bytes taken by a face record with three indices
+constexpr size_t TRIANGLE_RECORD_SIZE = 1 + 3 * sizeof(int);
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 must match the layout of a PLY vertex");
+
+static bool hostIsLittleEndian()
+{
+    const unsigned short probe = 1;
+    return *reinterpret_cast<const unsigned char *>(&probe) == 1;
+}
+
+// Runs task(i) for every i in [0, nTasks) using the given amount of threads
+template <typename Task>
+static void parallelFor(unsigned int threads, int nTasks, const Task &task)
+{
+    std::atomic<int> next(0);
+    auto worker = [&]()
+    {
+        for (int i = next++; i < nTasks; i = next++)
+            task(i);
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 1; t < std::min<unsigned int>(threads, nTasks); ++t)
+        workers.emplace_back(worker);
+    worker();
+    for (std::thread &thread : workers)
+        thread.join();
+}
+
+bool PLYReader::readMesh(const std::string &filename, TriangleMesh &mesh, unsigned int threads)
+{
+    TRACE_SCOPE("PLYReader::readMesh");
+    MappedFile file;
+    PLYHeader header;
+
+    if (!file.open(filename))
+        return false;
+    if (!parseHeader(file.data(), file.size(), header))
+        return false;
+    if (!header.binaryLayout)
+    {
+        file.close();
+        return readMeshStreamed(filename, mesh);
+    }
+    // Logged with a single write, meshes may be loaded from several threads at once
+    std::ostringstream log;
+    log << "Loading triangle mesh" << std::endl;
+    log << "\tVertices = " << header.nVertices << std::endl;
+    log << "\tFaces = " << header.nFaces << std::endl;
+    log << std::endl;
+    std::cout << log.str() << std::flush;
+
+    const char *data = file.data() + header.dataOffset;
+    const char *end = file.data() + file.size();
+    std::vector<glm::vec3> vertices;
+    std::vector<int> triangles;
+
+    if (!loadVertices(data, end, header.nVertices, vertices))
+        return false;
+    data += header.nVertices * sizeof(glm::vec3);
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (!loadFaces(data, end, header, threads, triangles))
+        return false;
+    file.close();
+
+    mesh.aabb = rescaleModel(vertices);
+    mesh.vertices.swap(vertices);
+    mesh.triangles.swap(triangles);
+
+    return true;
+}
+
+bool PLYReader::readMeshStreamed(const std::string &filename, TriangleMesh &mesh)
 {
     std::ifstream fin;
     int nVertices, nFaces;
@@ -136,3 +220,392 @@ void PLYReader::addModelToMesh(const std::vector<float> &plyVertices, const std:
     for (i = 0; i < plyTriangles.size(); i += 3)
         mesh.addTriangle(plyTriangles[i], plyTriangles[i + 1], plyTriangles[i + 2]);
 }
+
+bool PLYReader::parseHeader(const char *data, size_t size, PLYHeader &header)
+{
+    std::vector<std::string> elements;
+    int vertexProperties = 0, faceProperties = 0;
+    size_t offset = 0;
+    bool magic = false;
+
+    header = {0, 0, 0, hostIsLittleEndian()};
+    while (offset < size)
+    {
+        const char *eol = static_cast<const char *>(memchr(data + offset, '\n', size - offset));
+        if (!eol)
+            return false;
+        std::string line(data + offset, eol);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        offset = eol - data + 1;
+
+        std::istringstream sin(line);
+        std::string keyword;
+        sin >> keyword;
+        if (!magic)
+        {
+            if (keyword != "ply")
+                return false;
+            magic = true;
+        }
+        else if (keyword == "format")
+        {
+            std::string format;
+            sin >> format;
+            if (format != "binary_little_endian")
+                header.binaryLayout = false;
+        }
+        else if (keyword == "element")
+        {
+            std::string name;
+            int count = 0;
+            sin >> name >> count;
+            if (name == "vertex")
+                header.nVertices = count;
+            else if (name == "face")
+                header.nFaces = count;
+            elements.push_back(name);
+        }
+        else if (keyword == "property" && !elements.empty())
+        {
+            // Only float x, y, z vertices and a single uchar/int index list per face are decoded in bulk
+            std::string type, countType, indexType, name;
+            sin >> type;
+            if (elements.back() == "vertex")
+            {
+                sin >> name;
+                bool isFloat = (type == "float" || type == "float32");
+                if (!isFloat || vertexProperties >= 3 || name != std::string(1, "xyz"[vertexProperties]))
+                    header.binaryLayout = false;
+                ++vertexProperties;
+            }
+            else if (elements.back() == "face" && type == "list")
+            {
+                sin >> countType >> indexType;
+                bool isUchar = (countType == "uchar" || countType == "uint8");
+                bool isInt = (indexType == "int" || indexType == "int32");
+                if (!isUchar || !isInt)
+                    header.binaryLayout = false;
+                ++faceProperties;
+            }
+            else
+                header.binaryLayout = false;
+        }
+        else if (keyword == "end_header")
+        {
+            bool vertexFirst = (elements.size() >= 1 && elements[0] == "vertex");
+            bool faceSecond = (elements.size() == 1 || (elements.size() == 2 && elements[1] == "face"));
+            if (!vertexFirst || !faceSecond || vertexProperties != 3 || faceProperties > 1)
+                header.binaryLayout = false;
+            header.dataOffset = offset;
+            return header.nVertices > 0 && header.nFaces >= 0;
+        }
+    }
+    return false;
+}
+
+bool PLYReader::loadVertices(const char *data, const char *end, int nVertices, std::vector<glm::vec3> &vertices)
+{
+    size_t bytes = size_t(nVertices) * sizeof(glm::vec3);
+
+    if (size_t(end - data) < bytes)
+        return false;
+    vertices.resize(nVertices);
+    memcpy(vertices.data(), data, bytes);
+
+    return true;
+}
+
+bool PLYReader::loadFaces(const char *data, const char *end, const PLYHeader &header, unsigned int threads, std::vector<int> &triangles)
+{
+    std::vector<PLYFaceChunk> chunks;
+
+    if (!findFaceChunks(data, end - data, header, threads, chunks))
+        return false;
+
+    // Prefix sum of the triangles of each chunk gives it a disjoint range of the output
+    size_t nTriangles = 0;
+    for (PLYFaceChunk &chunk : chunks)
+    {
+        chunk.firstTriangle = nTriangles;
+        nTriangles += chunk.nTriangles;
+    }
+    triangles.resize(3 * nTriangles);
+
+    std::atomic<bool> valid(true);
+    parallelFor(threads, chunks.size(), [&](int i)
+    {
+        if (!decodeFaceChunk(data, chunks[i], header.nVertices, triangles.data()))
+            valid = false;
+    });
+
+    return valid;
+}
+
+// Splits the face block into chunks of FACES_PER_CHUNK records, validating the record boundaries
+bool PLYReader::findFaceChunks(const char *data, size_t size, const PLYHeader &header, unsigned int threads, std::vector<PLYFaceChunk> &chunks)
+{
+    int nChunks = (header.nFaces + FACES_PER_CHUNK - 1) / FACES_PER_CHUNK;
+    chunks.resize(nChunks);
+    for (int i = 0; i < nChunks; i++)
+        chunks[i].nFaces = std::min(FACES_PER_CHUNK, header.nFaces - i * FACES_PER_CHUNK);
+
+    // Meshes made only of triangles have fixed size records, so their boundaries
+    // can be checked in parallel instead of walking the whole block serially
+    if (size >= header.nFaces * TRIANGLE_RECORD_SIZE)
+    {
+        std::atomic<bool> onlyTriangles(true);
+        parallelFor(threads, nChunks, [&](int i)
+        {
+            const char *record = data + size_t(i) * FACES_PER_CHUNK * TRIANGLE_RECORD_SIZE;
+            for (int face = 0; face < chunks[i].nFaces && onlyTriangles; face++, record += TRIANGLE_RECORD_SIZE)
+            {
+                if (*record != 3)
+                    onlyTriangles = false;
+            }
+        });
+        if (onlyTriangles)
+        {
+            for (int i = 0; i < nChunks; i++)
+            {
+                chunks[i].offset = size_t(i) * FACES_PER_CHUNK * TRIANGLE_RECORD_SIZE;
+                chunks[i].nTriangles = chunks[i].nFaces;
+            }
+            return true;
+        }
+    }
+
+    // Otherwise jump from record to record counting the triangles the fans expand to
+    size_t offset = 0;
+    for (PLYFaceChunk &chunk : chunks)
+    {
+        chunk.offset = offset;
+        chunk.nTriangles = 0;
+        for (int face = 0; face < chunk.nFaces; face++)
+        {
+            if (offset >= size)
+                return false;
+            unsigned char nVrtxPerFace = data[offset];
+            if (nVrtxPerFace < 3)
+                return false;
+            offset += 1 + nVrtxPerFace * sizeof(int);
+            chunk.nTriangles += nVrtxPerFace - 2;
+        }
+    }
+
+    return offset <= size;
+}
+
+// Triangulates the fans of a chunk into its range of the output, rejecting indices outside of the vertex block
+bool PLYReader::decodeFaceChunk(const char *data, const PLYFaceChunk &chunk, int nVertices, int *triangles)
+{
+    const char *record = data + chunk.offset;
+    int *output = triangles + 3 * chunk.firstTriangle;
+
+    for (int face = 0; face < chunk.nFaces; face++)
+    {
+        unsigned char nVrtxPerFace = record[0];
+        const char *indices = record + 1;
+        int tri[3];
+
+        memcpy(tri, indices, 3 * sizeof(int));
+        output[0] = tri[0];
+        output[1] = tri[1];
+        output[2] = tri[2];
+        output += 3;
+        for (unsigned char vrtx = 3; vrtx < nVrtxPerFace; vrtx++)
+        {
+            tri[1] = tri[2];
+            memcpy(&tri[2], indices + vrtx * sizeof(int), sizeof(int));
+            output[0] = tri[0];
+            output[1] = tri[1];
+            output[2] = tri[2];
+            output += 3;
+        }
+        record = indices + nVrtxPerFace * sizeof(int);
+    }
+
+    const int *begin = triangles + 3 * chunk.firstTriangle;
+    for (const int *index = begin; index != output; ++index)
+    {
+        if (static_cast<unsigned int>(*index) >= static_cast<unsigned int>(nVertices))
+            return false;
+    }
+
+    return true;
+}
+
+bool PLYReader::visitMesh(const std::string &filename, PLYVisitor &visitor, bool rescale, int blockSize)
+{
+    if (blockSize < 1)
+    {
+        std::cerr << "E: " << filename << " can't be streamed in blocks of " << blockSize << " elements" << std::endl;
+        return false;
+    }
+
+    std::ifstream fin;
+    PLYHeader header;
+    AABB size, aabb;
+
+    if (rescale && !computeAABB(filename, size, blockSize))
+        return false;
+    if (!openBinary(filename, fin, header))
+        return false;
+    if (rescale)
+        aabb = rescaleVertices(size, nullptr, 0);
+    visitor.visitHeader(header.nVertices, header.nFaces, aabb);
+
+    std::vector<glm::vec3> vertices(std::min(blockSize, header.nVertices));
+    for (int first = 0; first < header.nVertices; first += blockSize)
+    {
+        int n = std::min(blockSize, header.nVertices - first);
+        if (!fin.read(reinterpret_cast<char *>(vertices.data()), n * sizeof(glm::vec3)))
+            return false;
+        if (rescale)
+            rescaleVertices(size, vertices.data(), n);
+        visitor.visitVertices(first, vertices.data(), n);
+    }
+
+    return visitFaces(fin, header, visitor, blockSize);
+}
+
+bool PLYReader::computeAABB(const std::string &filename, AABB &aabb, int blockSize)
+{
+    if (blockSize < 1)
+    {
+        std::cerr << "E: " << filename << " can't be streamed in blocks of " << blockSize << " elements" << std::endl;
+        return false;
+    }
+
+    std::ifstream fin;
+    PLYHeader header;
+
+    if (!openBinary(filename, fin, header))
+        return false;
+
+    std::vector<glm::vec3> vertices(std::min(blockSize, header.nVertices));
+    aabb = AABB();
+    for (int first = 0; first < header.nVertices; first += blockSize)
+    {
+        int n = std::min(blockSize, header.nVertices - first);
+        if (!fin.read(reinterpret_cast<char *>(vertices.data()), n * sizeof(glm::vec3)))
+            return false;
+        for (int i = 0; i < n; i++)
+        {
+            aabb.min = glm::min(aabb.min, vertices[i]);
+            aabb.max = glm::max(aabb.max, vertices[i]);
+        }
+    }
+
+    return true;
+}
+
+bool PLYReader::readHeader(const std::string &filename, PLYHeader &header)
+{
+    std::ifstream fin;
+    return openHeader(filename, fin, header);
+}
+
+// Opens the file and leaves it positioned at the end of the header
+bool PLYReader::openHeader(const std::string &filename, std::ifstream &fin, PLYHeader &header)
+{
+    std::string text, line;
+
+    fin.open(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!fin.is_open())
+        return false;
+    while (std::getline(fin, line))
+    {
+        text += line + "\n";
+        if (line.compare(0, 10, "end_header") == 0)
+            break;
+    }
+    return parseHeader(text.data(), text.size(), header);
+}
+
+// Opens the file and leaves it positioned at the start of the vertex block
+bool PLYReader::openBinary(const std::string &filename, std::ifstream &fin, PLYHeader &header)
+{
+    if (!openHeader(filename, fin, header))
+        return false;
+    if (!header.binaryLayout)
+    {
+        std::cerr << "E: " << filename << " can't be streamed, only binary little endian x, y, z vertices and triangle lists are supported" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Reads the face block through a byte window, carrying over records split between reads
+bool PLYReader::visitFaces(std::ifstream &fin, const PLYHeader &header, PLYVisitor &visitor, int blockSize)
+{
+    const size_t maxRecordSize = 1 + 255 * sizeof(int);
+    const int maxFanTriangles = 255 - 2;
+
+    blockSize = std::max(blockSize, maxFanTriangles);
+    std::vector<char> window(std::max(blockSize * TRIANGLE_RECORD_SIZE, 2 * maxRecordSize));
+    std::vector<int> triangles(3 * blockSize);
+    size_t begin = 0, end = 0;
+    int nTriangles = 0;
+
+    for (int i = 0; i < header.nFaces; i++)
+    {
+        // Refill the window when the next record might not be complete in it
+        if (end - begin < maxRecordSize)
+        {
+            memmove(window.data(), window.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+            fin.read(window.data() + end, window.size() - end);
+            end += fin.gcount();
+        }
+
+        if (begin >= end)
+            return false;
+        unsigned char nVrtxPerFace = window[begin];
+        size_t recordSize = 1 + nVrtxPerFace * sizeof(int);
+        if (nVrtxPerFace < 3 || end - begin < recordSize)
+            return false;
+
+        if (nTriangles + nVrtxPerFace - 2 > blockSize)
+        {
+            visitor.visitTriangles(triangles.data(), nTriangles);
+            nTriangles = 0;
+        }
+        PLYFaceChunk record = {begin, size_t(nTriangles), size_t(nVrtxPerFace - 2), 1};
+        if (!decodeFaceChunk(window.data(), record, header.nVertices, triangles.data()))
+            return false;
+        nTriangles += nVrtxPerFace - 2;
+        begin += recordSize;
+    }
+    if (nTriangles > 0)
+        visitor.visitTriangles(triangles.data(), nTriangles);
+
+    return true;
+}
+
+AABB PLYReader::rescaleModel(std::vector<glm::vec3> &vertices)
+{
+    AABB size;
+
+    for (const glm::vec3 &vertex : vertices)
+    {
+        size.min = glm::min(size.min, vertex);
+        size.max = glm::max(size.max, vertex);
+    }
+
+    return rescaleVertices(size, vertices.data(), vertices.size());
+}
+
+// Rescales vertices of a model whose AABB is size, returns the AABB of the rescaled model
+AABB PLYReader::rescaleVertices(const AABB &size, glm::vec3 *vertices, size_t n)
+{
+    glm::vec3 center = (size.max + size.min) / 2.0f;
+    glm::vec3 length = size.max - size.min;
+    float largestSize = std::max(length.x, std::max(length.y, length.z));
+
+    for (size_t i = 0; i < n; i++)
+        vertices[i] = (vertices[i] - center) / largestSize;
+
+    return AABB((size.min - center) / largestSize, (size.max - center) / largestSize);
+}
@@ -7,11 +7,63 @@
 
 #include "TriangleMesh.h"
 
+// Layout of a PLY file as described by its header
+struct PLYHeader
+{
+    int nVertices;
+    int nFaces;
+    size_t dataOffset; // Offset of the first byte after end_header
+    bool binaryLayout; // Little endian float x, y, z vertices followed by uchar/int face lists and nothing else
+};
+
+// Run of consecutive face records that is decoded as a unit
+struct PLYFaceChunk
+{
+    size_t offset;        // Offset of the first record from the start of the face block
+    size_t firstTriangle; // Index of the first triangle it expands to in the output
+    size_t nTriangles;
+    int nFaces;
+};
+
+// Receives the elements of a PLY file in blocks from PLYReader::visitMesh
+class PLYVisitor
+{
+
+public:
+    virtual ~PLYVisitor() {}
+
+    // Vertex and face counts, and the AABB of the rescaled model or an empty one when not rescaling
+    virtual void visitHeader(int, int, const AABB &) {}
+    virtual void visitVertices(int first, const glm::vec3 *vertices, int n) = 0;
+    virtual void visitTriangles(const int *indices, int nTriangles) = 0;
+};
+
 class PLYReader
 {
 
 public:
-    static bool readMesh(const std::string &filename, TriangleMesh &mesh);
+    // Maps the file and decodes its vertex and face blocks in bulk, splitting
+    // the face lists among threads (0 uses one per core). Files whose layout is
+    // not the one written by PLYWriter are handed to readMeshStreamed.
+    static bool readMesh(const std::string &filename, TriangleMesh &mesh, unsigned int threads = 0);
+
+    // Reads the file element by element through a stream
+    static bool readMeshStreamed(const std::string &filename, TriangleMesh &mesh);
+
+    // Streams the vertices and then the triangulated faces of a binary PLY file
+    // to the visitor in blocks of at most blockSize elements, so memory use does
+    // not depend on the size of the file. When rescale is set, a first pass
+    // over the vertex block computes the AABB used to rescale every vertex.
+    static bool visitMesh(const std::string &filename, PLYVisitor &visitor, bool rescale, int blockSize = 1 << 16);
+
+    // Reads the header alone
+    static bool readHeader(const std::string &filename, PLYHeader &header);
+
+    // Reads the vertex block alone, in blocks of blockSize vertices
+    static bool computeAABB(const std::string &filename, AABB &aabb, int blockSize = 1 << 16);
+
+    // Centers the vertices at the origin and scales them to fit a unit cube, returns their new AABB
+    static AABB rescaleModel(std::vector<glm::vec3> &vertices);
 
 private:
     static bool loadHeader(std::ifstream &fin, int &nVertices, int &nFaces);
@@ -19,6 +71,17 @@ private:
     static void loadFaces(std::ifstream &fin, int nFaces, std::vector<int> &plyTriangles);
     static void rescaleModel(std::vector<float> &plyVertices);
     static void addModelToMesh(const std::vector<float> &plyVertices, const std::vector<int> &plyTriangles, TriangleMesh &mesh);
+
+    static bool parseHeader(const char *data, size_t size, PLYHeader &header);
+    static bool loadVertices(const char *data, const char *end, int nVertices, std::vector<glm::vec3> &vertices);
+    static bool loadFaces(const char *data, const char *end, const PLYHeader &header, unsigned int threads, std::vector<int> &triangles);
+    static bool findFaceChunks(const char *data, size_t size, const PLYHeader &header, unsigned int threads, std::vector<PLYFaceChunk> &chunks);
+    static bool decodeFaceChunk(const char *data, const PLYFaceChunk &chunk, int nVertices, int *triangles);
+
+    static bool openHeader(const std::string &filename, std::ifstream &fin, PLYHeader &header);
+    static bool openBinary(const std::string &filename, std::ifstream &fin, PLYHeader &header);
+    static bool visitFaces(std::ifstream &fin, const PLYHeader &header, PLYVisitor &visitor, int blockSize);
+    static AABB rescaleVertices(const AABB &size, glm::vec3 *vertices, size_t n);
 };
 
 #endif // PLYREADER_H
@@ -1,47 +1,185 @@
 #include "PLYWriter.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 must match the layout of a PLY vertex");
+
+// Bytes gathered before they are written to the file
+constexpr size_t BUFFER_SIZE = 1 << 20;
+
+// Bytes taken by a face record with three indices
+constexpr size_t FACE_RECORD_SIZE = 1 + 3 * sizeof(int);
+
+// Element counts are zero padded to a fixed width so that they can be patched in place
+constexpr int COUNT_WIDTH = 10;
+
 bool PLYWriter::writeMesh(const std::string &filename, const TriangleMesh &mesh)
 {
-    std::ofstream fout(filename);
-    writeHeader(fout, mesh);
-    writeVertices(fout, mesh);
-    writeFaces(fout, mesh);
-    return true;
+    PLYWriter writer;
+    if (!writer.begin(filename))
+        return false;
+    writer.addVertices(mesh.vertices.data(), mesh.vertices.size());
+    writer.addTriangles(mesh.triangles.data(), mesh.triangles.size() / 3);
+    return writer.finalize();
+}
+
+void PLYWriter::writeMesh(const TriangleMesh &mesh, std::vector<char> &buffer)
+{
+    std::ostringstream header;
+    size_t nTriangles = mesh.triangles.size() / 3;
+
+    writeHeader(header, mesh.vertices.size(), nTriangles);
+    const std::string &text = header.str();
+    buffer.resize(text.size() + mesh.vertices.size() * sizeof(glm::vec3) + nTriangles * FACE_RECORD_SIZE);
+
+    char *output = buffer.data();
+    memcpy(output, text.data(), text.size());
+    output = writeVertices(output + text.size(), mesh.vertices.data(), mesh.vertices.size());
+    writeFaces(output, mesh.triangles.data(), nTriangles);
+}
+
+PLYWriter::PLYWriter()
+{
+    used = 0;
+    nVertices = 0;
+    nFaces = 0;
+    failed = false;
+}
+
+PLYWriter::~PLYWriter()
+{
+    if (fout.is_open())
+        finalize();
+}
+
+bool PLYWriter::begin(const std::string &filename)
+{
+    fout.open(filename, std::ios_base::out | std::ios_base::binary);
+    buffer.resize(BUFFER_SIZE);
+    used = 0;
+    nVertices = 0;
+    nFaces = 0;
+    failed = !fout.is_open();
+    if (!failed)
+        writeHeader(fout, 0, 0);
+    return !failed;
+}
+
+void PLYWriter::addVertex(const glm::vec3 &vertex)
+{
+    addVertices(&vertex, 1);
+}
+
+void PLYWriter::addVertices(const glm::vec3 *vertices, size_t n)
+{
+    if (nFaces > 0)
+    {
+        failed = true; // The vertex block has already been closed
+        return;
+    }
+    size_t bytes = n * sizeof(glm::vec3);
+    if (bytes >= buffer.size())
+    {
+        // Big blocks skip the buffer
+        flush();
+        fout.write(reinterpret_cast<const char *>(vertices), bytes);
+    }
+    else
+    {
+        reserve(bytes);
+        writeVertices(buffer.data() + used, vertices, n);
+        used += bytes;
+    }
+    nVertices += n;
+}
+
+void PLYWriter::addTriangle(int v0, int v1, int v2)
+{
+    int indices[3] = {v0, v1, v2};
+    addTriangles(indices, 1);
+}
+
+void PLYWriter::addTriangles(const int *indices, size_t nTriangles)
+{
+    while (nTriangles > 0)
+    {
+        size_t fit = (buffer.size() - used) / FACE_RECORD_SIZE;
+        if (fit == 0)
+        {
+            flush();
+            continue;
+        }
+        size_t n = std::min(fit, nTriangles);
+        writeFaces(buffer.data() + used, indices, n);
+        used += n * FACE_RECORD_SIZE;
+        indices += 3 * n;
+        nTriangles -= n;
+        nFaces += n;
+    }
+}
+
+bool PLYWriter::finalize()
+{
+    flush();
+    fout.seekp(0);
+    writeHeader(fout, nVertices, nFaces);
+    bool written = !failed && fout.good();
+    fout.close();
+    return written;
+}
+
+int PLYWriter::getVertexCount() const
+{
+    return nVertices;
 }
 
-void PLYWriter::writeHeader(std::ofstream &fout, const TriangleMesh &mesh)
+int PLYWriter::getFaceCount() const
 {
+    return nFaces;
+}
+
+void PLYWriter::writeHeader(std::ostream &fout, int nVertices, int nFaces)
+{
+    fout << std::setfill('0');
     fout << "ply\n";
     fout << "format binary_little_endian 1.0\n";
-    fout << "element vertex " << mesh.vertices.size() << "\n";
+    fout << "element vertex " << std::setw(COUNT_WIDTH) << nVertices << "\n";
     fout << "property float x\n";
     fout << "property float y\n";
     fout << "property float z\n";
-    fout << "element face " << mesh.triangles.size() / 3 << "\n";
+    fout << "element face " << std::setw(COUNT_WIDTH) << nFaces << "\n";
     fout << "property list uchar int vertex_index\n";
     fout << "end_header\n";
 }
 
-void PLYWriter::writeVertices(std::ofstream &fout, const TriangleMesh &mesh)
+char *PLYWriter::writeVertices(char *output, const glm::vec3 *vertices, size_t n)
 {
-    for (int i = 0; i < mesh.vertices.size(); ++i) {
-        glm::vec3 vertex = mesh.vertices[i];
-        fout.write(reinterpret_cast<char*>(&vertex.x), sizeof(float));
-        fout.write(reinterpret_cast<char*>(&vertex.y), sizeof(float));
-        fout.write(reinterpret_cast<char*>(&vertex.z), sizeof(float));
-    }
+    memcpy(output, vertices, n * sizeof(glm::vec3));
+    return output + n * sizeof(glm::vec3);
 }
 
-void PLYWriter::writeFaces(std::ofstream &fout, const TriangleMesh &mesh)
+char *PLYWriter::writeFaces(char *output, const int *indices, size_t nTriangles)
 {
-    for (int i = 0; i < mesh.triangles.size(); i += 3) {
-        unsigned char n = 3;
-        int i0 = mesh.triangles[i];
-        int i1 = mesh.triangles[i + 1];
-        int i2 = mesh.triangles[i + 2];
-        fout.write(reinterpret_cast<char*>(&n), sizeof(unsigned char));
-        fout.write(reinterpret_cast<char*>(&i0), sizeof(int));
-        fout.write(reinterpret_cast<char*>(&i1), sizeof(int));
-        fout.write(reinterpret_cast<char*>(&i2), sizeof(int));
+    for (size_t i = 0; i < nTriangles; ++i)
+    {
+        output[0] = 3;
+        memcpy(output + 1, indices + 3 * i, 3 * sizeof(int));
+        output += FACE_RECORD_SIZE;
     }
-}
\ No newline at end of file
+    return output;
+}
+
+void PLYWriter::reserve(size_t bytes)
+{
+    if (used + bytes > buffer.size())
+        flush();
+}
+
+void PLYWriter::flush()
+{
+    fout.write(buffer.data(), used);
+    used = 0;
+}
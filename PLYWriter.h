@@ -4,17 +4,54 @@
 #include "TriangleMesh.h"
 
 #include <fstream>
+#include <ostream>
 #include <string>
+#include <vector>
+
+// PLYWriter writes binary little endian PLY files. Besides writing a whole
+// TriangleMesh at once, it can stream a mesh out: begin, add all the vertices,
+// add all the faces and finalize, which patches the element counts of the
+// header. Elements are gathered in a buffer and written in large blocks.
 
 class PLYWriter
 {
 public:
     static bool writeMesh(const std::string &filename, const TriangleMesh &mesh);
 
+    // Serializes the whole file into the given buffer
+    static void writeMesh(const TriangleMesh &mesh, std::vector<char> &buffer);
+
+    PLYWriter();
+    ~PLYWriter();
+
+    bool begin(const std::string &filename);
+
+    // Every vertex has to be added before the first face
+    void addVertex(const glm::vec3 &vertex);
+    void addVertices(const glm::vec3 *vertices, size_t n);
+    void addTriangle(int v0, int v1, int v2);
+    void addTriangles(const int *indices, size_t nTriangles);
+
+    bool finalize();
+
+    int getVertexCount() const;
+    int getFaceCount() const;
+
+private:
+    static void writeHeader(std::ostream &fout, int nVertices, int nFaces);
+    static char *writeVertices(char *output, const glm::vec3 *vertices, size_t n);
+    static char *writeFaces(char *output, const int *indices, size_t nTriangles);
+
+    void reserve(size_t bytes);
+    void flush();
+
 private:
-    static void writeHeader(std::ofstream &fout, const TriangleMesh &mesh);
-    static void writeVertices(std::ofstream &fout, const TriangleMesh &mesh);
-    static void writeFaces(std::ofstream &fout, const TriangleMesh &mesh);
+    std::ofstream fout;
+    std::vector<char> buffer;
+    size_t used;
+    int nVertices;
+    int nFaces;
+    bool failed;
 };
 
-#endif // PLYWRITER_H
\ No newline at end of file
+#endif // PLYWRITER_H
@@ -1,18 +1,53 @@
 #include "Scene.h"
-#include "PLYReader.h"
+#include "Trace.h"
 
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/matrix_inverse.hpp>
 
 #include "imgui.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <map>
 #include <sstream>
-#include <queue>
 #include <string>
 
+// Color of walls and statues
+static const glm::vec4 DEFAULT_COLOR(0.9f, 0.9f, 0.95f, 1.0f);
+
+// Color of the statues when debug colors are enabled, from the coarsest to the finest lod: red, orange, yellow and green
+static const glm::vec4 DEBUG_COLORS[4] = {
+    {1.0f, 0.0f, 0.0f, 1.0f},
+    {1.0f, 0.5f, 0.0f, 1.0f},
+    {1.0f, 1.0f, 0.0f, 1.0f},
+    {0.5f, 1.0f, 0.0f, 1.0f},
+};
+
+// Models with other numbers of lods blend the colors in between
+static glm::vec4 debugColor(int lod, int nLods)
+{
+    if (nLods < 2) return DEBUG_COLORS[0];
+    float t = 3.0f * lod / (nLods - 1);
+    int i = std::min(int(t), 2);
+    return glm::mix(DEBUG_COLORS[i], DEBUG_COLORS[i + 1], t - i);
+}
+
+// Where the LOD selection problems are recorded
+static const std::string LOD_PROBLEMS_FILE = "lod_problems.txt";
+
+// Rendering cost coefficients written by CostCalibration
+static const std::string COST_MODEL_FILE = "cost_model.txt";
+
+// Binding point and std140 layout of the Frame uniform block in shaders/basic.vs
+constexpr GLuint FRAME_UNIFORMS_BINDING = 0;
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+};
+
 Scene::Scene()
 {
 
@@ -26,60 +61,94 @@ Scene::~Scene()
 void Scene::init()
 {
     initShaders();
+    frameUniforms.init(FRAME_UNIFORMS_BINDING, sizeof(FrameUniforms));
 
     currentTime = 0.0f;
 
     camera.init();
 
-    wall.buildCube();
-    wall.sendToOpenGL(basicProgram);
-
     TPS = 1e7;
     FPS = 60.0f;
+    benefitModel = BENEFIT_PROJECTED_SIZE;
+    CostBenefitModel &costBenefit = planner.getCostBenefit();
+    if (costBenefit.load(COST_MODEL_FILE)) {
+        TPS = costBenefit.getTrianglesPerSecond();
+        const RenderCost &renderCost = costBenefit.getRenderCost();
+        std::cout << "Rendering cost: " << renderCost.triangle << " us per triangle, " << renderCost.vertex << " us per vertex, "
+                  << renderCost.object << " us per object" << std::endl;
+    }
+
+    geometry.init();
+    drawList.init();
+    debugColors = false;
+
+    gpuTimer.init();
+    profiler.init();
+    frameTime.reset(TPS);
+    calibrateTPS = true;
+    measurements = 0;
+    gpuMs = 0.0f;
+    renderedTriangles = 0;
+    renderedCost = 0.0f;
+    renderedDraws = 0;
+
+    budgetMB = residency.getBudget() >> 20;
+    wallTriangles = 0;
+    wallCost = 0.0f;
+    lodSolver = LOD_SOLVER_INCREMENTAL;
+    deterministic = false;
+    recordProblems = false;
+    culling = CULLING_CPU_OCCLUSION;
+    statuesOccluded = 0;
+    occlusionMs = 0.0f;
 }
 
 
 bool Scene::loadScene(const std::string &filename)
 {
     std::vector<int> modelIndex;
+    std::vector<MuseumStatue> statues;
     if (!loadModels(filename, modelIndex)) return false;
-    if (!loadFloorPlan(filename, modelIndex)) return false;
-    if (!loadVisibility(filename)) return false;
+    if (!loadFloorPlan(filename, modelIndex, statues)) return false;
+    if (!loadVisibility(filename, statues)) return false;
     return true;
 }
 
 bool Scene::loadModels(const std::string &filename, std::vector<int> &modelIndex)
 {
+    TRACE_SCOPE("Scene::loadModels");
     std::string models_extension = ".m";
     std::ifstream fin(filename + models_extension);
     if (!fin.is_open()) return false;
 
     modelIndex = std::vector<int>(256, -1);
 
+    // Characters that refer to the same directory share its model, so it is loaded once
+    std::vector<std::string> modelDirectories;
+    std::map<std::string, int> directoryIndex;
     int n;
     fin >> n;
     for (int i = 0; i < n; ++i) {
         unsigned char c;
         std::string modelDirectory;
         fin >> c >> modelDirectory;
-        models.emplace_back();
-        loadModel(modelDirectory, models[i]);
-        modelIndex[c] = i;
+        auto inserted = directoryIndex.emplace(modelDirectory, modelDirectories.size());
+        if (inserted.second) modelDirectories.push_back(modelDirectory);
+        modelIndex[c] = inserted.first->second;
     }
-    return true;
-}
+    models = std::vector<MeshLods>(modelDirectories.size());
+    residency.init(models, modelDirectories, geometry);
 
-void Scene::loadModel(const std::string &modelDirectory, MeshLods &model)
-{
-    for (int i = 0; i < 4; ++i) {
-        TriangleMesh &lod = model.lods[i];
-        std::string meshFilename = modelDirectory + "/" + std::to_string(i) + ".ply";
-        PLYReader::readMesh(meshFilename, lod);
-        lod.sendToOpenGL(basicProgram);
+    // The planner only needs what is known before the finer LODs are loaded
+    std::vector<PlannerModel> plannerModels;
+    for (const MeshLods &meshLods : models) {
+        plannerModels.push_back({meshLods.info, meshLods.lods[0].aabb});
     }
+    planner.setModels(plannerModels);
+    return true;
 }
 
-bool Scene::loadFloorPlan(const std::string &filename, std::vector<int> &modelIndex)
+bool Scene::loadFloorPlan(const std::string &filename, std::vector<int> &modelIndex, std::vector<MuseumStatue> &statues)
 {
     std::string floor_plan_extension = ".tm";
     std::ifstream fin(filename + floor_plan_extension);
@@ -87,24 +156,40 @@ bool Scene::loadFloorPlan(const std::string &filename, std::vector<int> &modelIn
 
     fin >> width >> height;
     floorPlan = std::vector<std::vector<int>> (width, std::vector<int>(height, -1));
+    std::vector<std::vector<bool>> isWall(width, std::vector<bool>(height, false));
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
             unsigned char c;
             fin >> c;
-            if (c == 'x') walls.emplace_back(x, y);
-            else if (modelIndex[c] >= 0) floorPlan[x][y] = modelIndex[c];
+            if (c == 'x') isWall[x][y] = true;
+            else if (modelIndex[c] >= 0) {
+                floorPlan[x][y] = modelIndex[c];
+                statues.push_back({modelIndex[c], {x, y}});
+            }
         }
     }
+    occlusionQueries.init(geometry, statues.size());
+
+    // Walls never move, so their geometry is merged once
+    walls.build(isWall, geometry);
+    std::cout << "Walls: " << walls.getTiles().size() << " tiles, " << walls.getTriangleCount() << " triangles" << std::endl;
     return true;
 }
 
-bool Scene::loadVisibility(const std::string &filename)
+bool Scene::loadVisibility(const std::string &filename, const std::vector<MuseumStatue> &statues)
 {
     std::string visibility_extension = ".v";
     std::ifstream fin(filename + visibility_extension);
     if (!fin.is_open()) return false;
 
-    visibleFrom = std::vector<std::vector<std::vector<glm::ivec2>>> (width, std::vector<std::vector<glm::ivec2>>(height));
+    std::vector<std::vector<int>> statueAt(width, std::vector<int>(height, -1));
+    for (unsigned int i = 0; i < statues.size(); ++i) {
+        statueAt[statues[i].position.x][statues[i].position.y] = i;
+    }
+
+    // Each cell has its own set of visible statues, only the positions with statues are stored (walls are always rendered)
+    std::vector<std::vector<int>> visibleSets(width * height);
+    std::vector<int> setOfCell(width * height);
     for (int x = 0; x < width; ++x) {
         for (int y = 0; y < height; ++y) {
             std::string line;
@@ -113,167 +198,298 @@ bool Scene::loadVisibility(const std::string &filename)
 
             int x_0, y_0;
             sin >> x_0 >> y_0;
+            int cell = x_0 * height + y_0;
+            setOfCell[cell] = cell;
             int x_vis, y_vis;
-            while (sin >> x_vis >> y_vis) visibleFrom[x_0][y_0].push_back({x_vis, y_vis});
+            while (sin >> x_vis >> y_vis) {
+                if (statueAt[x_vis][y_vis] >= 0) visibleSets[cell].push_back(statueAt[x_vis][y_vis]);
+            }
         }
     }
+    planner.setMuseum(width, height, statues, visibleSets, setOfCell);
     return true;
 }
 
 void Scene::update(int deltaTime)
 {
+    StageTimer timer(profiler, TIMER_UPDATE);
+    TRACE_SCOPE("Scene::update");
     currentTime += deltaTime;
     camera.update(deltaTime);
 }
 
 void Scene::render()
 {
+    TRACE_SCOPE("Scene::render");
+    // Fit the frame time model to the frames measured since the last one
+    long long tag;
+    double milliseconds;
+    while (gpuTimer.collect(tag, milliseconds)) {
+        const MeasuredFrame &measured = measuredFrames[tag % GPU_TIMER_LATENCY];
+        frameTime.addSample(measured.cost, measured.draws, milliseconds);
+        profiler.addGpuTime(TIMER_GPU_SCENE, measured.frame, milliseconds);
+        gpuMs = milliseconds;
+    }
+
+    // Occlusion query results come back after a number of frames that depends on the GPU, the CPU buffer's don't
+    if (deterministic && culling == CULLING_GPU_OCCLUSION) {
+        culling = CULLING_CPU_OCCLUSION;
+    }
+
     if (ImGui::Begin("Settings")) {
-        ImGui::SliderFloat("TPS", &TPS, 1e7, 1e10, "%g", ImGuiSliderFlags_Logarithmic);
+        ImGui::SliderFloat("Target FPS", &FPS, 10.0f, 240.0f, "%.0f");
+        if (gpuTimer.isSupported() && ImGui::Checkbox("Calibrate TPS from GPU time", &calibrateTPS) && calibrateTPS) {
+            frameTime.reset(TPS);
+        }
+        if (!calibrateTPS || !gpuTimer.isSupported()) {
+            ImGui::SliderFloat("TPS", &TPS, 1e7, 1e10, "%g", ImGuiSliderFlags_Logarithmic);
+        }
         ImGui::Checkbox("Enable/Disable debug colors", &debugColors);
+        ImGui::SliderFloat("LOD budget (MB)", &budgetMB, 16.0f, 4096.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+        ImGui::Text("Resident: %.1f MB, loading %d LODs", residency.getResidentBytes() / float(1 << 20), residency.getLoadingCount());
+        ImGui::Combo("Culling", &culling, "Visibility file\0Visibility file + CPU occlusion\0GPU occlusion queries\0");
+        ImGui::Text("Statues: %d candidates, %d in frustum, %d occluded (%.2f ms)",
+                    planner.getPotentiallyVisibleCount(), int(planner.getCandidates().size()) + statuesOccluded, statuesOccluded, occlusionMs);
+        ImGui::Combo("Benefit", &benefitModel, "Distance\0Projected size\0");
+        ImGui::Combo("LOD solver", &lodSolver, "Incremental\0Greedy\0Convex hull\0");
+        const LodSelector &lodSelector = planner.getSelector();
+        ImGui::Text("LOD selection: %.3f ms, %d changes", planner.getTimings().selection, lodSelector.getMoveCount());
+        if (lodSelector.getUpperBound() >= 0.0f) {
+            ImGui::Text("Benefit: %.4f, at most %.4f", lodSelector.getBenefit(), lodSelector.getUpperBound());
+        }
+        ImGui::Checkbox("Record LOD problems", &recordProblems);
+        if (culling == CULLING_GPU_OCCLUSION) {
+            ImGui::Text("Occlusion queries: %d issued, %d pending", occlusionQueries.getIssuedCount(), occlusionQueries.getPendingCount());
+        }
     }
     ImGui::End();
 
     const glm::mat4 &view = camera.getViewMatrix();
     const glm::mat4 &projection = camera.getProjectionMatrix();
+    frustum = Frustum(projection * view);
+    occlusion.clear(projection * view);
+    occlusionMs = 0.0f;
+
+    FrameUniforms uniforms = {view, projection};
+    frameUniforms.update(&uniforms, sizeof(uniforms));
 
     basicProgram.use();
-    basicProgram.setUniformMatrix4f("view", view);
-    basicProgram.setUniformMatrix4f("projection", projection);
-    basicProgram.setUniform1i("bLighting", 1);
-    basicProgram.setUniform4f("color", 0.9f, 0.9f, 0.95f, 1.0f);
+    basicProgram.setUniform(lightingUniform, 1);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    
+
+    // Measurements are numbered so that the ones in flight use different entries of measuredFrames
+    bool measuring = gpuTimer.begin(measurements);
+    drawList.clear();
     renderWalls();
-    renderStatues();     
+    int draws = 0;
+    if (culling == CULLING_GPU_OCCLUSION) {
+        // The walls must be in the depth buffer before the statues are queried against it
+        StageTimer timer(profiler, TIMER_WALLS);
+        draws += drawList.getCommandCount();
+        drawList.submit(geometry);
+        drawList.clear();
+    }
+    renderStatues();
+    renderedDraws = draws + drawList.getCommandCount();
+    {
+        StageTimer timer(profiler, TIMER_STATUES);
+        drawList.submit(geometry);
+    }
+    gpuTimer.end();
+    if (measuring) {
+        measuredFrames[measurements++ % GPU_TIMER_LATENCY] = {renderedCost, renderedDraws, profiler.getFrame()};
+    }
 }
 
-float Scene::distanceToCamera(const glm::ivec2 &statuePosition) const
+void Scene::renderStatistics()
 {
-    return glm::length(camera.getPosition() - glm::vec3(statuePosition.x, 0.0f, statuePosition.y));
+    float targetMs = 1000.0f / FPS;
+    ImGui::Text("%d triangles (cost %.0f), %d draws", renderedTriangles, renderedCost, renderedDraws);
+    if (!gpuTimer.isSupported()) {
+        ImGui::Text("GPU time: timer queries not supported");
+        return;
+    }
+    ImGui::Text("GPU time: %.2f ms, target %.2f ms, error %+.2f ms", gpuMs, targetMs, gpuMs - targetMs);
+    ImGui::Text("Estimate: %.3g TPS, %.2f us per draw (%d frames)",
+                frameTime.getTrianglesPerSecond(), frameTime.getDrawMicroseconds(), frameTime.getSampleCount());
+    if (calibrateTPS) {
+        ImGui::Text("Triangle budget: %.0f", frameTime.getBudget());
+    }
 }
 
-float Scene::deltaBenefit(int lod, int index) const
+void Scene::renderStatues()
 {
-    const Statue &statue = PVS[index];
-    const AABB &statueAABB = statue.meshLods.lods[0].aabb;
-
-    float D = distanceToCamera(statue.position);
-    
-    // Compute the squared and augmented bounding box to obtain the max edge length
-    glm::vec3 length = statueAABB.max - statueAABB.min;
-    float max_length = std::max(length.x, std::max(length.y, length.z));
-    float d = 1.1f * glm::length(glm::vec3(max_length));
-    
-    return d / (D * glm::pow(2, lod + 5)); // lod + 5 to obtain the subdivision level according to its lod
+    residency.setBudget(size_t(budgetMB) << 20);
+    residency.beginFrame();
+    recomputePVS();
+    selectLods();
+
+    // One draw per (model, lod), with its instances colored by lod
+    StageTimer timer(profiler, TIMER_STATUES);
+    TRACE_SCOPE("Scene::renderStatues");
+    const std::vector<MuseumStatue> &statues = planner.getStatues();
+    const std::vector<int> &instances = planner.getInstances();
+    for (const PlannedDraw &draw : planner.getDraws()) {
+        int nLods = models[draw.model].lods.size();
+        drawList.addDraw(models[draw.model].lods[draw.lod]);
+        glm::vec4 color = debugColors ? debugColor(draw.lod, nLods) : DEFAULT_COLOR;
+        for (int k = draw.firstInstance; k < draw.firstInstance + draw.nInstances; ++k) {
+            drawList.addInstance(cellTransform(statues[instances[k]].position), color);
+        }
+    }
 }
 
-float Scene::deltaCost(int lod, int index) const
+void Scene::selectLods()
 {
-    const Statue &statue = PVS[index];
-    const MeshLods &meshLods = statue.meshLods;
-    int new_triangles = meshLods.lods[lod].triangles.size();
-    int previous_triangles = meshLods.lods[lod-1].triangles.size();
-    return new_triangles - previous_triangles;
+    StageTimer timer(profiler, TIMER_LOD_SELECTION);
+    TRACE_SCOPE("Scene::selectLods");
+
+    // The walls are always drawn, the statues share what remains of the budget
+    float budget = TPS / FPS - wallCost;
+    if (calibrateTPS && gpuTimer.isSupported() && !deterministic) {
+        // The draws of this frame aren't known yet, those of the last one are close
+        budget = frameTime.updateBudget(1000.0f / FPS, renderedDraws) - wallCost;
+    }
+    LodSelector &lodSelector = planner.getSelector();
+    lodSelector.setSolver(LodSolver(lodSolver));
+    lodSelector.setTimeLimit(deterministic ? NO_SOLVER_TIME_LIMIT : DEFAULT_SOLVER_TIME_LIMIT);
+    planner.getCostBenefit().setBenefitModel(BenefitModel(benefitModel));
+    planner.selectLods(camera.getViewMatrix(), camera.getProjectionMatrix(), budget, [&](int model, int lod) {
+        return residency.isAvailable(model, lod);
+    });
+    if (recordProblems) {
+        if (!problemsFile.is_open()) problemsFile.open(LOD_PROBLEMS_FILE, std::ios::app);
+        lodSelector.writeProblem(problemsFile, budget);
+    }
+
+    // Stream the assigned LODs and render the best resident ones meanwhile
+    const std::vector<int> &candidates = planner.getCandidates();
+    const std::vector<MuseumStatue> &statues = planner.getStatues();
+    if (deterministic) {
+        for (unsigned int i = 0; i < candidates.size(); ++i) {
+            residency.request(statues[candidates[i]].model, planner.getSelectedLod(i));
+        }
+        residency.finishLoading();
+    }
+    std::vector<int> statueLodRendered(candidates.size());
+    for (unsigned int i = 0; i < candidates.size(); ++i) {
+        int model = statues[candidates[i]].model;
+        int lod = planner.getSelectedLod(i);
+        residency.request(model, lod);
+        statueLodRendered[i] = residency.bestResident(model, lod);
+    }
+    planner.buildDraws(statueLodRendered);
+    renderedTriangles = wallTriangles + planner.getTriangleCount();
+    renderedCost = wallCost + planner.getCost();
 }
 
-Assignment Scene::nextAssignment(int index, int lod) const
+CameraPathFrame Scene::getPathFrame()
 {
-    return {index, lod + 1, deltaBenefit(lod + 1, index), deltaCost(lod + 1, index)};
+    float tps = TPS;
+    if (calibrateTPS && gpuTimer.isSupported() && !deterministic) tps = frameTime.getBudget() * FPS;
+    return {camera.getPosition(), camera.getTheta(), camera.getPhi(), tps, FPS, uint8_t(debugColors)};
 }
 
-void Scene::renderStatues()
+void Scene::setPathFrame(const CameraPathFrame &frame)
 {
-    recomputePVS();
-
-    int n = PVS.size();
-    
-    // Initial assignment of each statue to its lowest lod
-    std::vector<int> statuesLod(n, 0);
+    camera.setPose(frame.position, frame.theta, frame.phi);
+    TPS = frame.TPS;
+    FPS = frame.FPS;
+    debugColors = frame.debugColors != 0;
+}
 
-    // Priority queue of improvements to make in the current assignment
-    using PriorityQueue = std::priority_queue<Assignment,std::vector<Assignment>,AssignmentPriority>;
-    PriorityQueue improvements;
-    for (int i = 0; i < n; ++i) {
-        improvements.push(nextAssignment(i, 0));
-    }
+void Scene::setDeterministic(bool deterministic)
+{
+    this->deterministic = deterministic;
+}
 
-    // Initialize cost with the number of triangles of walls + initial assignment
-    float cost = walls.size() * 12;
-    for (int i = 0; i < n; ++i) {
-        const Statue &statue = PVS[i];
-        float cost_to_add = statue.meshLods.lods[0].triangles.size() / 3;
-        cost += cost_to_add;
-    }
+void Scene::stopLoading()
+{
+    residency.stopLoading();
+}
 
-    // Greedy algorithm to compute assignments
-    float max_cost = TPS/FPS;
-    while (cost < max_cost && !improvements.empty()) {
-        Assignment assignment = improvements.top();
-        improvements.pop();
-        if (cost + assignment.cost <= max_cost) {
-            cost += assignment.cost;
-            statuesLod[assignment.index] = assignment.lod;
-            if (assignment.lod < 3) { 
-                improvements.push(nextAssignment(assignment.index, assignment.lod));
-            }
-        }
+void Scene::getFrameStatistics(FrameStatistics &statistics) const
+{
+    statistics.triangles = renderedTriangles;
+    statistics.draws = renderedDraws;
+    statistics.potentiallyVisible = planner.getPotentiallyVisibleCount();
+    statistics.lodHistogram.assign(getMaxLodCount(), 0);
+    for (const PlannedDraw &draw : planner.getDraws()) {
+        statistics.lodHistogram[draw.lod] += draw.nInstances;
     }
+}
 
-    // Render final assignments with its corresponding color
-    for (int i = 0; i < n; ++i) {
-        const Statue &statue = PVS[i];
-        int lod = statuesLod[i];
-        if (debugColors) {
-            switch(lod) {
-                case 0:
-                    basicProgram.setUniform4f("color", 1.0f, 0.0f, 0.0f, 1.0f);
-                    break;
-                case 1:
-                    basicProgram.setUniform4f("color", 1.0f, 0.5, 0.0f, 0.0f);
-                    break;
-                case 2:
-                    basicProgram.setUniform4f("color", 1.0f, 1.0f, 0.0f, 0.0f);
-                    break; 
-                case 3:
-                    basicProgram.setUniform4f("color", 0.5f, 1.0f, 0.0f, 1.0f);
-                    break;
-            }
-        }
-        render(statue.meshLods.lods[lod], statue.position);
+int Scene::getMaxLodCount() const
+{
+    int maxLods = 0;
+    for (const MeshLods &meshLods : models) {
+        maxLods = std::max(maxLods, int(meshLods.lods.size()));
     }
+    return maxLods;
 }
 
 void Scene::renderWalls()
 {
-    for (const glm::ivec2 &gridCoordinates : walls)
-        render(wall, gridCoordinates);
+    StageTimer timer(profiler, TIMER_WALLS);
+    TRACE_SCOPE("Scene::renderWalls");
+
+    // Tiles are already in world coordinates, each one a single instance
+    wallTriangles = 0;
+    wallCost = 0.0f;
+    const std::vector<TriangleMesh> &tiles = walls.getTiles();
+    for (unsigned int i = 0; i < tiles.size(); ++i) {
+        if (!frustum.intersects(tiles[i].aabb)) continue;
+        drawList.addDraw(tiles[i]);
+        drawList.addInstance(glm::mat4(1.0f), DEFAULT_COLOR);
+        wallTriangles += tiles[i].getTriangleCount();
+        wallCost += planner.getCostBenefit().getCost(tiles[i].getTriangleCount(), tiles[i].getArenaRange().nVertices);
+
+        // The visible tiles are also the occluders of the statues
+        if (culling == CULLING_CPU_OCCLUSION) {
+            auto start = std::chrono::steady_clock::now();
+            occlusion.rasterize(walls.getOccluders(i));
+            occlusionMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
 }
 
-void Scene::render(const TriangleMesh &mesh, const glm::ivec2 &gridCoordinates)
+glm::mat4 Scene::cellTransform(const glm::ivec2 &gridCoordinates)
 {
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(gridCoordinates.x + 0.5f, 0.5f, gridCoordinates.y + 0.5f));
-    basicProgram.setUniformMatrix4f("model", model);
-
-    const glm::mat4 &view = camera.getViewMatrix();
-    glm::mat3 normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-    basicProgram.setUniformMatrix3f("normalMatrix", normalMatrix);
-
-    mesh.render();
+    return glm::translate(glm::mat4(1.0f), FramePlanner::cellOrigin(gridCoordinates));
 }
 
 void Scene::recomputePVS()
 {
-    PVS.clear();
+    StageTimer timer(profiler, TIMER_VISIBILITY);
+    TRACE_SCOPE("Scene::recomputePVS");
 
+    // The visibility file is only used when the walls don't occlude the statues on the GPU
     glm::vec3 cameraPosition = camera.getPosition();
-    glm::ivec2 gridPosition = glm::ivec2(cameraPosition.x, cameraPosition.z);
-    gridPosition = glm::clamp(gridPosition, glm::ivec2(0, 0), glm::ivec2(width-1, height-1));
-
-    for (auto statueGridPosition : visibleFrom[gridPosition.x][gridPosition.y]) {
-        int modelIndex = floorPlan[statueGridPosition.x][statueGridPosition.y];
-        PVS.push_back({models[modelIndex], statueGridPosition});
+    planner.findCandidates(cameraPosition, frustum, culling != CULLING_GPU_OCCLUSION);
+
+    // The statues hidden behind the walls don't compete for the budget either
+    auto start = std::chrono::steady_clock::now();
+    statuesOccluded = 0;
+    if (culling == CULLING_CPU_OCCLUSION) {
+        occlusion.updateTiles();
+        statuesOccluded = planner.cullCandidates([&](int statue) {
+            return !occlusion.isVisible(planner.getStatueAABB(statue));
+        });
     }
+    if (culling == CULLING_GPU_OCCLUSION) {
+        // Results of previous frames decide this one, the queries issued now decide the next ones
+        const std::vector<int> &candidates = planner.getCandidates();
+        std::vector<AABB> boxes;
+        for (int statue : candidates) {
+            boxes.push_back(planner.getStatueAABB(statue));
+        }
+        occlusionQueries.collectResults();
+        occlusionQueries.issueQueries(candidates, boxes, cameraPosition);
+        statuesOccluded = planner.cullCandidates([&](int statue) {
+            return !occlusionQueries.isVisible(statue);
+        });
+    }
+    occlusionMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 Camera &Scene::getCamera()
@@ -281,6 +497,11 @@ Camera &Scene::getCamera()
     return camera;
 }
 
+FrameProfiler &Scene::getProfiler()
+{
+    return profiler;
+}
+
 void Scene::initShaders()
 {
     Shader vShader, fShader;
@@ -307,6 +528,8 @@ void Scene::initShaders()
         std::cout << "" << basicProgram.log() << std::endl << std::endl;
     }
     basicProgram.bindFragmentOutput("fragColor");
+    basicProgram.bindUniformBlock("Frame", FRAME_UNIFORMS_BINDING);
+    lightingUniform = basicProgram.getUniform<int>("bLighting");
     vShader.free();
     fShader.free();
 }
@@ -2,9 +2,22 @@
 #define _SCENE_INCLUDE
 
 #include "Camera.h"
+#include "CameraPath.h"
+#include "DrawList.h"
+#include "FramePlanner.h"
+#include "FrameProfiler.h"
+#include "FrameTimeController.h"
+#include "Frustum.h"
+#include "GeometryArena.h"
+#include "GpuTimer.h"
+#include "LodResidency.h"
+#include "OcclusionBuffer.h"
+#include "OcclusionQueries.h"
 #include "ShaderProgram.h"
 #include "TriangleMesh.h"
 #include "TimeCritical.h"
+#include "UniformBuffer.h"
+#include "WallTiles.h"
 
 #include <glm/glm.hpp>
 
@@ -16,6 +29,23 @@
 // Scene contains all the entities of our game.
 // It is responsible for updating and render them.
 
+// How the statues that can't be seen are found
+enum Culling
+{
+    CULLING_PVS, // Visibility file and view frustum
+    CULLING_CPU_OCCLUSION, // Also tested against the walls rasterized on the CPU
+    CULLING_GPU_OCCLUSION, // View frustum and occlusion queries, without the visibility file
+};
+
+// What the last frame rendered, for the camera path playback
+struct FrameStatistics
+{
+    int triangles;
+    int draws;
+    int potentiallyVisible; // Statues in the visibility set of the camera cell
+    std::vector<int> lodHistogram; // Statues drawn with each LOD
+};
+
 class Scene
 {
 
@@ -27,44 +57,88 @@ public:
     bool loadScene(const std::string &filename);
     void update(int deltaTime);
     void render();
+    void renderStatistics(); // Inside the performance statistics window
+
+    // Camera and settings of the current frame, to record or replay a camera path
+    CameraPathFrame getPathFrame();
+    void setPathFrame(const CameraPathFrame &frame);
+
+    // Loads the selected LODs before rendering, keeps the TPS fixed, lets the LOD solver finish and culls with the
+    // CPU occlusion buffer instead of occlusion queries, so that frames don't depend on timing
+    void setDeterministic(bool deterministic);
+
+    // Joins the threads that load LODs in the background, at exit
+    void stopLoading();
+    void getFrameStatistics(FrameStatistics &statistics) const;
+    int getMaxLodCount() const;
 
     Camera &getCamera();
+    FrameProfiler &getProfiler();
 
 private:
     void initShaders();
 
     bool loadModels(const std::string &filename, std::vector<int> &modelIndex);
-    bool loadFloorPlan(const std::string &filename, std::vector<int> &modelIndex);
-    bool loadVisibility(const std::string &filename);
-
-    void loadModel(const std::string &modelDirectory, MeshLods &model);
+    bool loadFloorPlan(const std::string &filename, std::vector<int> &modelIndex, std::vector<MuseumStatue> &statues);
+    bool loadVisibility(const std::string &filename, const std::vector<MuseumStatue> &statues);
 
     void renderWalls();
     void renderStatues();
-    void render(const TriangleMesh &mesh, const glm::ivec2 &gridCoordinates);
-
-    float distanceToCamera(const glm::ivec2 &gridCoordinates) const;
-    float deltaCost(int lod, int index) const;
-    float deltaBenefit(int lod, int index) const;
-    Assignment nextAssignment(int lod, int index) const;
+    static glm::mat4 cellTransform(const glm::ivec2 &gridCoordinates);
 
     void recomputePVS();
+    void selectLods(); // Of the candidates, and the draws of the LODs that are resident
 
 private:
     // Scene element
     Camera camera;
-    TriangleMesh wall;
     std::vector<MeshLods> models; // models
-    std::vector<glm::ivec2> walls; // walls to render
+    LodResidency residency; // LODs of the models living in OpenGL buffers
+    GeometryArena geometry; // vertices and indices of every model LOD and wall tile
+    DrawList drawList; // draws of the current frame
+    WallTiles walls; // merged wall geometry, in tiles
+    Frustum frustum; // view frustum of the current frame
     ShaderProgram basicProgram;
+    Uniform<int> lightingUniform;
+    UniformBuffer frameUniforms; // Frame block of the shaders
 
     // Time critical rendering data
     float TPS;
     float FPS;
+    float budgetMB;
+    FramePlanner planner; // candidate statues, their LODs and draws, with costs in triangle equivalents
+    int benefitModel;
+    int wallTriangles; // triangles of the wall tiles rendered in the current frame
+    float wallCost;
+    int lodSolver;
+    bool deterministic;
+    bool recordProblems; // write every LOD selection problem to LOD_PROBLEMS_FILE, for LodSolverBench
+    std::ofstream problemsFile;
+    int renderedTriangles; // triangles of the walls and statues rendered in the current frame
+    float renderedCost;
+    int renderedDraws;
+
+    // Frame time control
+    struct MeasuredFrame
+    {
+        float cost;
+        int draws;
+        long long frame; // Of the profiler
+    };
+    GpuTimer gpuTimer; // GPU time of the scene in each frame
+    FrameTimeController frameTime; // triangle budget that holds the target frame time, fitted to the measured frames
+    bool calibrateTPS;
+    long long measurements; // frames whose GPU time was measured, the tag of the next one
+    MeasuredFrame measuredFrames[GPU_TIMER_LATENCY]; // of the measurements in flight, by tag
+    float gpuMs; // last measured GPU time
+    FrameProfiler profiler; // CPU and GPU time of each stage of the last frames
 
     // Visibility data
-    std::vector<Statue> PVS;
-    std::vector<std::vector<std::vector<glm::ivec2>>> visibleFrom; // visibility[x][y] is a list of the positions visible from (x,y), only store those with statues (walls are always rendered)
+    OcclusionBuffer occlusion; // depth of the walls in the view, rasterized on the CPU
+    OcclusionQueries occlusionQueries; // visibility of the statues against the walls drawn on the GPU
+    int culling;
+    int statuesOccluded; // statues in the frustum hidden by the walls
+    float occlusionMs; // time spent on occlusion culling, on the CPU
     std::vector<std::vector<int>> floorPlan; // map[x][y] is the index to the model occupying position (x,y)
 
     // Other data
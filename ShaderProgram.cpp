@@ -42,11 +42,35 @@ void ShaderProgram::link()
     linked = (status == GL_TRUE);
     glGetProgramInfoLog(programId, 512, NULL, buffer);
     errorLog.assign(buffer);
+
+    // Resolve every uniform once, so that setting one doesn't need to ask the driver
+    uniformLocations.clear();
+    if (!linked)
+        return;
+    GLint nUniforms;
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORMS, &nUniforms);
+    for (GLint i = 0; i < nUniforms; ++i)
+    {
+        GLsizei length;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(programId, i, sizeof(buffer), &length, &size, &type, buffer);
+        std::string name(buffer, length);
+        GLint location = glGetUniformLocation(programId, name.c_str());
+        if (location == -1)
+            continue; // Uniform blocks are set through buffers
+        uniformLocations[name] = location;
+
+        // Arrays are reported as name[0], but can also be referred to as name
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            uniformLocations[name.substr(0, name.size() - 3)] = location;
+    }
 }
 
 void ShaderProgram::free()
 {
     glDeleteProgram(programId);
+    uniformLocations.clear();
 }
 
 void ShaderProgram::use()
@@ -54,6 +78,11 @@ void ShaderProgram::use()
     glUseProgram(programId);
 }
 
+GLuint ShaderProgram::getId() const
+{
+    return programId;
+}
+
 bool ShaderProgram::isLinked()
 {
     return linked;
@@ -64,9 +93,59 @@ const std::string &ShaderProgram::log() const
     return errorLog;
 }
 
+GLint ShaderProgram::findUniform(const std::string &uniformName) const
+{
+    auto found = uniformLocations.find(uniformName);
+    return found != uniformLocations.end() ? found->second : -1;
+}
+
+void ShaderProgram::bindUniformBlock(const std::string &blockName, GLuint bindingPoint)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(programId, blockName.c_str());
+
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(programId, blockIndex, bindingPoint);
+}
+
+void ShaderProgram::setUniform(Uniform<int> uniform, int v)
+{
+    if (uniform.location != -1)
+        glUniform1i(uniform.location, v);
+}
+
+void ShaderProgram::setUniform(Uniform<glm::vec2> uniform, const glm::vec2 &v)
+{
+    if (uniform.location != -1)
+        glUniform2fv(uniform.location, 1, glm::value_ptr(v));
+}
+
+void ShaderProgram::setUniform(Uniform<glm::vec3> uniform, const glm::vec3 &v)
+{
+    if (uniform.location != -1)
+        glUniform3fv(uniform.location, 1, glm::value_ptr(v));
+}
+
+void ShaderProgram::setUniform(Uniform<glm::vec4> uniform, const glm::vec4 &v)
+{
+    if (uniform.location != -1)
+        glUniform4fv(uniform.location, 1, glm::value_ptr(v));
+}
+
+void ShaderProgram::setUniform(Uniform<glm::mat3> uniform, const glm::mat3 &mat)
+{
+    if (uniform.location != -1)
+        glUniformMatrix3fv(uniform.location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+void ShaderProgram::setUniform(Uniform<glm::mat4> uniform, const glm::mat4 &mat)
+{
+    if (uniform.location != -1)
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
 void ShaderProgram::setUniform1i(const std::string &uniformName, int v)
 {
-    GLint location = glGetUniformLocation(programId, uniformName.c_str());
+    GLint location = findUniform(uniformName);
 
     if (location != -1)
         glUniform1i(location, v);
@@ -74,7 +153,7 @@ void ShaderProgram::setUniform1i(const std::string &uniformName, int v)
 
 void ShaderProgram::setUniform2f(const std::string &uniformName, float v0, float v1)
 {
-    GLint location = glGetUniformLocation(programId, uniformName.c_str());
+    GLint location = findUniform(uniformName);
 
     if (location != -1)
         glUniform2f(location, v0, v1);
@@ -82,7 +161,7 @@ void ShaderProgram::setUniform2f(const std::string &uniformName, float v0, float
 
 void ShaderProgram::setUniform3f(const std::string &uniformName, float v0, float v1, float v2)
 {
-    GLint location = glGetUniformLocation(programId, uniformName.c_str());
+    GLint location = findUniform(uniformName);
 
     if (location != -1)
         glUniform3f(location, v0, v1, v2);
@@ -90,7 +169,7 @@ void ShaderProgram::setUniform3f(const std::string &uniformName, float v0, float
 
 void ShaderProgram::setUniform4f(const std::string &uniformName, float v0, float v1, float v2, float v3)
 {
-    GLint location = glGetUniformLocation(programId, uniformName.c_str());
+    GLint location = findUniform(uniformName);
 
     if (location != -1)
         glUniform4f(location, v0, v1, v2, v3);
@@ -98,7 +177,7 @@ void ShaderProgram::setUniform4f(const std::string &uniformName, float v0, float
 
 void ShaderProgram::setUniformMatrix3f(const std::string &uniformName, const glm::mat3 &mat)
 {
-    GLint location = glGetUniformLocation(programId, uniformName.c_str());
+    GLint location = findUniform(uniformName);
 
     if (location != -1)
         glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat));
@@ -106,7 +185,7 @@ void ShaderProgram::setUniformMatrix3f(const std::string &uniformName, const glm
 
 void ShaderProgram::setUniformMatrix4f(const std::string &uniformName, const glm::mat4 &mat)
 {
-    GLint location = glGetUniformLocation(programId, uniformName.c_str());
+    GLint location = findUniform(uniformName);
 
     if (location != -1)
         glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
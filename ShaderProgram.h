@@ -2,11 +2,19 @@
 #define _SHADER_PROGRAM_INCLUDE
 
 #include <string>
+#include <unordered_map>
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <glm/glm.hpp>
 #include "Shader.h"
 
+// Location of a uniform, resolved once after linking and typed by the value it takes
+template <typename T>
+struct Uniform
+{
+    GLint location = -1;
+};
+
 // Using the Shader class ShaderProgram can link a vertex and a fragment shader
 // together, bind input attributes to their corresponding vertex shader names,
 // and bind the fragment output to a name from the fragment shader
@@ -26,7 +34,25 @@ public:
 
     void use();
 
-    // Pass uniforms to the associated shaders
+    // Handle to a uniform of the linked program, its location is -1 if the uniform isn't active
+    template <typename T>
+    Uniform<T> getUniform(const std::string &uniformName) const
+    {
+        return {findUniform(uniformName)};
+    }
+
+    // Makes the named uniform block read the buffer bound to bindingPoint
+    void bindUniformBlock(const std::string &blockName, GLuint bindingPoint);
+
+    // Pass uniforms to the associated shaders through their handles
+    void setUniform(Uniform<int> uniform, int v);
+    void setUniform(Uniform<glm::vec2> uniform, const glm::vec2 &v);
+    void setUniform(Uniform<glm::vec3> uniform, const glm::vec3 &v);
+    void setUniform(Uniform<glm::vec4> uniform, const glm::vec4 &v);
+    void setUniform(Uniform<glm::mat3> uniform, const glm::mat3 &mat);
+    void setUniform(Uniform<glm::mat4> uniform, const glm::mat4 &mat);
+
+    // Pass uniforms to the associated shaders by name
     void setUniform1i(const std::string &uniformName, int v);
     void setUniform2f(const std::string &uniformName, float v0, float v1);
     void setUniform3f(const std::string &uniformName, float v0, float v1, float v2);
@@ -35,13 +61,18 @@ public:
     void setUniformMatrix3f(const std::string &uniformName, const glm::mat3 &mat);
     void setUniformMatrix4f(const std::string &uniformName, const glm::mat4 &mat);
 
+    GLuint getId() const;
     bool isLinked();
     const std::string &log() const;
 
+private:
+    GLint findUniform(const std::string &uniformName) const;
+
 private:
     GLuint programId;
     bool linked;
     std::string errorLog;
+    std::unordered_map<std::string, GLint> uniformLocations; // Of the active uniforms outside blocks
 };
 
 #endif // _SHADER_PROGRAM_INCLUDE
@@ -0,0 +1,232 @@
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+#include "DrawList.h"
+#include "GeometryArena.h"
+#include "ShaderProgram.h"
+#include "TriangleMesh.h"
+#include "UniformBuffer.h"
+
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+
+// Measures the CPU cost of submitting a draw the way Scene used to (uniforms
+// set by name, looked up in the driver on every call), with uniform handles
+// resolved at link time, with one indirect command per draw in a single
+// multi draw, and with every draw folded into one instanced command. Meshes
+// are tiny cubes in a shared geometry arena so that the GPU isn't the
+// bottleneck.
+
+// Vertex shader with per draw uniforms, as used before instancing
+const std::string PER_DRAW_VERTEX_SHADER = R"(#version 330 core
+layout(location = 0) in vec3 mPos;
+layout(location = 1) in vec3 mNormal;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat3 normalMatrix;
+out vec3 eNormal;
+out vec4 vColor;
+void main()
+{
+  eNormal = normalMatrix * mNormal;
+  vColor = vec4(1.0);
+  gl_Position = projection * view * model * vec4(mPos, 1.0);
+}
+)";
+
+struct Timing
+{
+    double submit; // Nanoseconds per draw to issue the calls
+    double finish; // Nanoseconds per draw until the GPU is done
+};
+
+// Best timing over all repetitions of submitting draws
+Timing timeSubmission(std::function<void()> submit, int draws, int repetitions)
+{
+    using Clock = std::chrono::steady_clock;
+    Timing best = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+    for (int r = 0; r < repetitions; ++r)
+    {
+        glFinish();
+        Clock::time_point start = Clock::now();
+        submit();
+        Clock::time_point submitted = Clock::now();
+        glFinish();
+        Clock::time_point finished = Clock::now();
+
+        best.submit = std::min(best.submit, std::chrono::duration<double, std::nano>(submitted - start).count() / draws);
+        best.finish = std::min(best.finish, std::chrono::duration<double, std::nano>(finished - start).count() / draws);
+    }
+    return best;
+}
+
+bool linkProgram(ShaderProgram &program, const std::string &vertexSource, const std::string &fragmentFilename)
+{
+    Shader vShader, fShader;
+    vShader.initFromSource(VERTEX_SHADER, vertexSource);
+    fShader.initFromFile(FRAGMENT_SHADER, fragmentFilename);
+    if (!vShader.isCompiled() || !fShader.isCompiled())
+    {
+        std::cerr << vShader.log() << fShader.log() << std::endl;
+        return false;
+    }
+    program.init();
+    program.addShader(vShader);
+    program.addShader(fShader);
+    program.link();
+    vShader.free();
+    fShader.free();
+    if (!program.isLinked())
+        std::cerr << program.log() << std::endl;
+    return program.isLinked();
+}
+
+bool readFile(const std::string &filename, std::string &text)
+{
+    std::ifstream fin(filename);
+    if (!fin.is_open())
+        return false;
+    text.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+    return true;
+}
+
+glm::mat4 cellTransform(int i)
+{
+    return glm::translate(glm::mat4(1.0f), glm::vec3(i % 100 + 0.5f, 0.5f, i / 100 + 0.5f));
+}
+
+const int DEFAULT_DRAWS = 10000;
+const int DEFAULT_REPETITIONS = 10;
+
+int main(int argc, char **argv)
+{
+    int draws = DEFAULT_DRAWS;
+    if (argc > 1)
+    {
+        draws = std::max(1, std::atoi(argv[1]));
+    }
+
+    int repetitions = DEFAULT_REPETITIONS;
+    if (argc > 2)
+    {
+        repetitions = std::max(1, std::atoi(argv[2]));
+    }
+
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(64, 64);
+    glutCreateWindow(argv[0]);
+    glewExperimental = GL_TRUE;
+    glewInit();
+    glEnable(GL_DEPTH_TEST);
+
+    std::string instancedSource;
+    ShaderProgram perDrawProgram, instancedProgram;
+    if (!readFile("shaders/basic.vs", instancedSource) ||
+        !linkProgram(perDrawProgram, PER_DRAW_VERTEX_SHADER, "shaders/basic.fs") ||
+        !linkProgram(instancedProgram, instancedSource, "shaders/basic.fs"))
+    {
+        std::cerr << "Failed to build the shaders, run from the repository root" << std::endl;
+        return -1;
+    }
+
+    GeometryArena arena;
+    arena.init();
+    TriangleMesh cube;
+    cube.buildCube();
+    cube.sendToOpenGL(arena);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(50.0f, 80.0f, -20.0f), glm::vec3(50.0f, 0.0f, 50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 200.0f);
+
+    // Before: every uniform looked up by name on every draw
+    perDrawProgram.use();
+    glUniformMatrix4fv(glGetUniformLocation(perDrawProgram.getId(), "view"), 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(perDrawProgram.getId(), "projection"), 1, GL_FALSE, &projection[0][0]);
+    Timing byName = timeSubmission([&]() {
+        for (int i = 0; i < draws; ++i)
+        {
+            glm::mat4 model = cellTransform(i);
+            glm::mat3 normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+            glUniformMatrix4fv(glGetUniformLocation(perDrawProgram.getId(), "model"), 1, GL_FALSE, &model[0][0]);
+            glUniformMatrix3fv(glGetUniformLocation(perDrawProgram.getId(), "normalMatrix"), 1, GL_FALSE, &normalMatrix[0][0]);
+            cube.render();
+        }
+    }, draws, repetitions);
+
+    // Handles resolved once at link time
+    Uniform<glm::mat4> modelUniform = perDrawProgram.getUniform<glm::mat4>("model");
+    Uniform<glm::mat3> normalMatrixUniform = perDrawProgram.getUniform<glm::mat3>("normalMatrix");
+    Timing byHandle = timeSubmission([&]() {
+        for (int i = 0; i < draws; ++i)
+        {
+            glm::mat4 model = cellTransform(i);
+            perDrawProgram.setUniform(modelUniform, model);
+            perDrawProgram.setUniform(normalMatrixUniform, glm::mat3(glm::inverseTranspose(view * model)));
+            cube.render();
+        }
+    }, draws, repetitions);
+
+    // Frame uniform block and per-instance transforms, one draw for all cubes
+    UniformBuffer frameUniforms;
+    glm::mat4 frame[2] = {view, projection};
+    frameUniforms.init(0, sizeof(frame));
+    frameUniforms.update(frame, sizeof(frame));
+    instancedProgram.bindUniformBlock("Frame", 0);
+    instancedProgram.use();
+    DrawList drawList;
+    drawList.init();
+    Timing multiDraw = timeSubmission([&]() {
+        drawList.clear();
+        for (int i = 0; i < draws; ++i)
+        {
+            drawList.addDraw(cube);
+            drawList.addInstance(cellTransform(i), glm::vec4(1.0f));
+        }
+        drawList.submit(arena);
+    }, draws, repetitions);
+
+    Timing instanced = timeSubmission([&]() {
+        drawList.clear();
+        drawList.addDraw(cube);
+        for (int i = 0; i < draws; ++i)
+            drawList.addInstance(cellTransform(i), glm::vec4(1.0f));
+        drawList.submit(arena);
+    }, draws, repetitions);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR)
+    {
+        std::cerr << "E: OpenGL error " << error << std::endl;
+        return -1;
+    }
+
+    std::cout << draws << " draws of " << cube.getTriangleCount() << " triangles, best of " << repetitions << std::endl;
+    std::cout << "\tBy name:    " << byName.submit << " ns/draw submitted, " << byName.finish << " ns/draw finished" << std::endl;
+    std::cout << "\tBy handle:  " << byHandle.submit << " ns/draw submitted, " << byHandle.finish << " ns/draw finished ("
+              << byName.submit / byHandle.submit << "x)" << std::endl;
+    std::cout << "\tMulti draw: " << multiDraw.submit << " ns/draw submitted, " << multiDraw.finish << " ns/draw finished ("
+              << byName.submit / multiDraw.submit << "x)" << std::endl;
+    std::cout << "\tInstanced:  " << instanced.submit << " ns/draw submitted, " << instanced.finish << " ns/draw finished ("
+              << byName.submit / instanced.submit << "x)" << std::endl;
+
+    drawList.free();
+    frameUniforms.free();
+    cube.free();
+    arena.free();
+    perDrawProgram.free();
+    instancedProgram.free();
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ThreadPool runs submitted tasks on a fixed set of worker threads, in the
+// order they were submitted. When stopped or destroyed, the tasks that have
+// not started yet are discarded and the running ones are waited for.
+
+class ThreadPool
+{
+
+public:
+    // 0 threads uses one per core
+    ThreadPool(unsigned int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Joins the workers, tasks submitted afterwards never run
+    void stop();
+
+    unsigned int getThreadCount() const;
+
+private:
+    void work();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping;
+};
+
+#endif // THREADPOOL_H
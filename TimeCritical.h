@@ -1,42 +1,18 @@
+#ifndef _TIME_CRITICAL_INCLUDE
+#define _TIME_CRITICAL_INCLUDE
+
+#include "LodMetadata.h"
 #include "TriangleMesh.h"
 
 #include "glm/glm.hpp"
 
-#include <array>
+#include <vector>
 
-// lod -> subdivision level
-// 0 -> 5
-// 1 -> 6
-// 2 -> 7
-// 3 -> 8
+// LODs of a model in increasing level of detail, as many as MeshSimplifier wrote
 struct MeshLods
 {
-    std::array<TriangleMesh, 4> lods;
-};
-
-
-struct Statue
-{
-    const MeshLods &meshLods;
-    glm::ivec2 position;
-};
-
-struct Assignment
-{
-    int index;
-    int lod;
-    float benefit;
-    float cost;
+    std::vector<TriangleMesh> lods;
+    std::vector<LodInfo> info; // Known even when the LOD isn't resident
 };
 
-static float value(const Assignment &assignment)
-{
-    return assignment.benefit / assignment.cost;    
-}
-
-struct AssignmentPriority
-{
-    bool operator()(const Assignment &lhs, const Assignment &rhs) {
-        return value(lhs) < value(rhs);
-    }
-};
+#endif // _TIME_CRITICAL_INCLUDE
@@ -0,0 +1,97 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct TraceEvent
+{
+    const char *name;
+    int64_t start;
+    int64_t duration;
+};
+
+struct TraceBuffer
+{
+    std::vector<TraceEvent> events; // Ring of TRACE_BUFFER_EVENTS
+    uint64_t count; // Events recorded, including the overwritten ones
+};
+
+// Buffers of every thread that has recorded, in the order they started, which gives their thread ids
+static std::mutex buffersMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+static thread_local TraceBuffer *threadBuffer = nullptr;
+
+static const Clock::time_point traceStart = Clock::now();
+
+int64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - traceStart).count();
+}
+
+void Trace::record(const char *name, int64_t start, int64_t end)
+{
+    // Only the first event of a thread takes the lock
+    if (threadBuffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.emplace_back(new TraceBuffer{std::vector<TraceEvent>(TRACE_BUFFER_EVENTS), 0});
+        threadBuffer = buffers.back().get();
+    }
+    threadBuffer->events[threadBuffer->count % TRACE_BUFFER_EVENTS] = {name, start, end - start};
+    ++threadBuffer->count;
+}
+
+bool Trace::write(const std::string &filename)
+{
+    std::ofstream fout(filename);
+    if (!fout.is_open())
+    {
+        std::cerr << "Couldn't write the trace to " << filename << std::endl;
+        return false;
+    }
+
+    // Complete events ("X") with times in microseconds
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    uint64_t nEvents = 0, nDropped = 0;
+    const char *separator = "";
+    fout << "{\"traceEvents\":[";
+    fout.precision(3);
+    fout << std::fixed;
+    for (unsigned int thread = 0; thread < buffers.size(); ++thread)
+    {
+        const TraceBuffer &buffer = *buffers[thread];
+        uint64_t first = buffer.count > TRACE_BUFFER_EVENTS ? buffer.count - TRACE_BUFFER_EVENTS : 0;
+        for (uint64_t i = first; i < buffer.count; ++i)
+        {
+            const TraceEvent &event = buffer.events[i % TRACE_BUFFER_EVENTS];
+            fout << separator << "\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+                 << ",\"ts\":" << event.start * 1e-3 << ",\"dur\":" << event.duration * 1e-3 << "}";
+            separator = ",";
+        }
+        nEvents += buffer.count - first;
+        nDropped += first;
+    }
+    fout << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    std::cout << "Wrote " << nEvents << " trace events of " << buffers.size() << " threads to " << filename;
+    if (nDropped > 0)
+        std::cout << " (" << nDropped << " older ones overwritten)";
+    std::cout << std::endl;
+    return bool(fout);
+}
+
+TraceScope::TraceScope(const char *name) : name(name)
+{
+    start = Trace::now();
+}
+
+TraceScope::~TraceScope()
+{
+    Trace::record(name, start, Trace::now());
+}
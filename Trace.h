@@ -0,0 +1,56 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+
+// Events kept per thread, the oldest ones are overwritten
+constexpr int TRACE_BUFFER_EVENTS = 1 << 16;
+
+// Trace records how long named scopes take on every thread and writes them as
+// Chrome trace events (JSON), to be opened in Perfetto or chrome://tracing.
+// Each thread records into its own ring buffer, so that recording takes no
+// lock, and the buffers outlive their threads until the trace is written.
+//
+// Tracing is compiled in with ENABLE_TRACING (the ENABLE_TRACING option of
+// CMake); otherwise TRACE_SCOPE and TRACE_WRITE compile to nothing.
+
+class Trace
+{
+
+public:
+    // Nanoseconds since the start of the trace
+    static int64_t now();
+
+    // name has to outlive the trace, like a string literal
+    static void record(const char *name, int64_t start, int64_t end);
+
+    // Every recorded event, while no thread is recording
+    static bool write(const std::string &filename);
+};
+
+// TraceScope records the time from its construction to its destruction
+class TraceScope
+{
+
+public:
+    TraceScope(const char *name);
+    ~TraceScope();
+
+private:
+    const char *name;
+    int64_t start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef ENABLE_TRACING
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_WRITE(filename) Trace::write(filename)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_WRITE(filename) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -1,10 +1,14 @@
 #include "TriangleMesh.h"
+#include "VertexCache.h"
 
 TriangleMesh::TriangleMesh()
 {
     aabb = {};
     vertices = {};
     triangles = {};
+    arena = nullptr;
+    range = {};
+    nTriangles = 0;
 }
 
 void TriangleMesh::addVertex(const glm::vec3 &position)
@@ -39,60 +43,107 @@ void TriangleMesh::buildCube()
                    0, 1, 4, 5, 4, 1,
                    2, 3, 7, 7, 6, 2};
 
-    int i;
-
-    for (i = 0; i < 8; i += 1)
-        addVertex(0.5f * glm::vec3(vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]));
-    for (i = 0; i < 12; i++)
-        addTriangle(faces[3 * i], faces[3 * i + 1], faces[3 * i + 2]);
+    // Corners aren't shared, so that every face keeps its own normal
+    for (int i = 0; i < 36; i++)
+        addVertex(0.5f * glm::vec3(vertices[3 * faces[i]], vertices[3 * faces[i] + 1], vertices[3 * faces[i] + 2]));
+    for (int i = 0; i < 12; i++)
+        addTriangle(3 * i, 3 * i + 1, 3 * i + 2);
 }
 
-void TriangleMesh::sendToOpenGL(ShaderProgram &program)
+void TriangleMesh::buildIndexedData(std::vector<float> &data, std::vector<int> &indices) const
 {
-    std::vector<float> data;
-
+    // Normals weighted by the area of the triangles around each vertex
+    std::vector<glm::vec3> normals(vertices.size(), glm::vec3(0.0f));
     for (unsigned int tri = 0; tri < triangles.size(); tri += 3)
     {
-        glm::vec3 normal;
-
-        normal = glm::cross(vertices[triangles[tri + 1]] - vertices[triangles[tri]],
-                            vertices[triangles[tri + 2]] - vertices[triangles[tri]]);
-        normal = glm::normalize(normal);
+        glm::vec3 normal = glm::cross(vertices[triangles[tri + 1]] - vertices[triangles[tri]],
+                                      vertices[triangles[tri + 2]] - vertices[triangles[tri]]);
         for (unsigned int vrtx = 0; vrtx < 3; vrtx++)
-        {
-            data.push_back(vertices[triangles[tri + vrtx]].x);
-            data.push_back(vertices[triangles[tri + vrtx]].y);
-            data.push_back(vertices[triangles[tri + vrtx]].z);
-
-            data.push_back(normal.x);
-            data.push_back(normal.y);
-            data.push_back(normal.z);
-        }
+            normals[triangles[tri + vrtx]] += normal;
     }
 
+    indices = triangles;
+    VertexCache::optimize(indices, vertices.size());
+    std::vector<int> newIndex;
+    int nUsed = VertexCache::reorderVertices(indices, vertices.size(), newIndex);
+
+    data.assign(6 * nUsed, 0.0f);
+    for (unsigned int v = 0; v < vertices.size(); v++)
+    {
+        if (newIndex[v] < 0)
+            continue;
+        glm::vec3 normal = normals[v];
+        float length = glm::length(normal);
+        if (length > 0.0f)
+            normal /= length;
+
+        float *vertexData = &data[6 * newIndex[v]];
+        vertexData[0] = vertices[v].x;
+        vertexData[1] = vertices[v].y;
+        vertexData[2] = vertices[v].z;
+        vertexData[3] = normal.x;
+        vertexData[4] = normal.y;
+        vertexData[5] = normal.z;
+    }
+}
+
+void TriangleMesh::sendToOpenGL(GeometryArena &arena)
+{
+    std::vector<float> data;
+    std::vector<int> indices;
+
+    buildIndexedData(data, indices);
+    sendToOpenGL(arena, data.data(), data.size() / 6, indices.data(), indices.size() / 3);
+}
+
+void TriangleMesh::sendToOpenGL(GeometryArena &arena, const float *data, int nVertices, const int *indices, int nTriangles)
+{
     // Send data to OpenGL
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
-    posLocation = program.bindVertexAttribute("mPos", 3, 6 * sizeof(float), 0);
-    normalLocation = program.bindVertexAttribute("mNormal", 3, 6 * sizeof(float), (void *)(3 * sizeof(float)));
+    if (arena.add(data, nVertices, indices, 3 * nTriangles, range))
+    {
+        this->arena = &arena;
+        this->nTriangles = nTriangles;
+    }
 }
 
 void TriangleMesh::render() const
 {
-    glBindVertexArray(vao);
-    glEnableVertexAttribArray(posLocation);
-    glEnableVertexAttribArray(normalLocation);
-    glDrawArrays(GL_TRIANGLES, 0, 3 * 2 * 3 * triangles.size() / 3);
+    if (arena == nullptr)
+        return;
+    arena->bind();
+    glDrawElementsBaseVertex(GL_TRIANGLES, range.nIndices, GL_UNSIGNED_INT, (void *)(range.firstIndex * sizeof(int)), range.baseVertex);
 }
 
 void TriangleMesh::free()
 {
-    glDeleteBuffers(1, &vbo);
-    glDeleteVertexArrays(1, &vao);
+    if (arena != nullptr)
+        arena->remove(range);
+    arena = nullptr;
+    range = {};
 
     vertices.clear();
     triangles.clear();
+    nTriangles = 0;
+}
+
+void TriangleMesh::relocate()
+{
+    if (arena != nullptr)
+        arena->relocate(range);
+}
+
+void TriangleMesh::freeGeometry()
+{
+    std::vector<glm::vec3>().swap(vertices);
+    std::vector<int>().swap(triangles);
+}
+
+const ArenaRange &TriangleMesh::getArenaRange() const
+{
+    return range;
+}
+
+int TriangleMesh::getTriangleCount() const
+{
+    return nTriangles;
 }
@@ -2,7 +2,7 @@
 #define _TRIANGLE_MESH_INCLUDE
 
 #include "AABB.h"
-#include "ShaderProgram.h"
+#include "GeometryArena.h"
 
 #include <glm/glm.hpp>
 
@@ -19,10 +19,27 @@ public:
 
     void buildCube();
 
-    void sendToOpenGL(ShaderProgram &program);
+    // Interleaved position and smooth normal of every used vertex, and the
+    // triangles reordered for the vertex cache and renumbered to match them
+    void buildIndexedData(std::vector<float> &data, std::vector<int> &indices) const;
+
+    // Stores the mesh in the arena, until it is freed
+    void sendToOpenGL(GeometryArena &arena);
+    void sendToOpenGL(GeometryArena &arena, const float *data, int nVertices, const int *indices, int nTriangles);
+
+    // Draws the mesh alone, DrawList submits many of them at once
     void render() const;
     void free();
 
+    // Moves the mesh down into free space of its arena, so that the arena can shrink
+    void relocate();
+
+    // Drops the vertices and triangles once they have been sent to OpenGL
+    void freeGeometry();
+
+    const ArenaRange &getArenaRange() const;
+    int getTriangleCount() const;
+
     std::vector<glm::vec3> vertices;
     std::vector<int> triangles;
 
@@ -30,9 +47,9 @@ public:
 
 private:
 
-    GLuint vao;
-    GLuint vbo;
-    GLint posLocation, normalLocation;
+    GeometryArena *arena; // Arena holding the mesh once sent to OpenGL
+    ArenaRange range;
+    int nTriangles; // Triangles sent to OpenGL
 };
 
 #endif // _TRIANGLE_MESH_INCLUDE
@@ -0,0 +1,26 @@
+#include "UniformBuffer.h"
+
+UniformBuffer::UniformBuffer()
+{
+    ubo = 0;
+}
+
+void UniformBuffer::init(GLuint bindingPoint, size_t size)
+{
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ubo);
+}
+
+void UniformBuffer::free()
+{
+    glDeleteBuffers(1, &ubo);
+    ubo = 0;
+}
+
+void UniformBuffer::update(const void *data, size_t size)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+}
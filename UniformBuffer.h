@@ -0,0 +1,29 @@
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <cstddef>
+
+// UniformBuffer owns the OpenGL buffer behind a uniform block, bound to a
+// fixed binding point. Programs read it after ShaderProgram::bindUniformBlock,
+// so data shared by all draws of a frame is uploaded once.
+
+class UniformBuffer
+{
+
+public:
+    UniformBuffer();
+
+    void init(GLuint bindingPoint, size_t size);
+    void free();
+
+    // data has to follow the std140 layout of the block
+    void update(const void *data, size_t size);
+
+private:
+    GLuint ubo;
+};
+
+#endif // UNIFORMBUFFER_H
@@ -0,0 +1,131 @@
+#include "VertexCache.h"
+
+void VertexCache::optimize(std::vector<int> &triangles, int nVertices, int cacheSize)
+{
+    int nTriangles = triangles.size() / 3;
+
+    // Triangles around each vertex, stored contiguously
+    std::vector<int> firstAdjacent(nVertices + 1, 0), adjacent(3 * nTriangles);
+    for (int index : triangles)
+        ++firstAdjacent[index + 1];
+    for (int v = 0; v < nVertices; ++v)
+        firstAdjacent[v + 1] += firstAdjacent[v];
+    std::vector<int> fill(firstAdjacent.begin(), firstAdjacent.end() - 1);
+    for (int i = 0; i < 3 * nTriangles; ++i)
+        adjacent[fill[triangles[i]]++] = i / 3;
+
+    // live[v] counts the triangles of v that haven't been emitted yet
+    std::vector<int> live(nVertices);
+    for (int v = 0; v < nVertices; ++v)
+        live[v] = firstAdjacent[v + 1] - firstAdjacent[v];
+
+    std::vector<int> cacheTime(nVertices, 0), deadEnds, candidates, output;
+    std::vector<bool> emitted(nTriangles, false);
+    output.reserve(triangles.size());
+    int timestamp = cacheSize + 1;
+    int cursor = 0;
+
+    int fanning = nVertices > 0 ? 0 : -1;
+    while (fanning >= 0)
+    {
+        // Emit the remaining triangles around the fanning vertex
+        candidates.clear();
+        for (int i = firstAdjacent[fanning]; i < firstAdjacent[fanning + 1]; ++i)
+        {
+            int t = adjacent[i];
+            if (emitted[t])
+                continue;
+            for (int k = 0; k < 3; ++k)
+            {
+                int v = triangles[3 * t + k];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (timestamp - cacheTime[v] > cacheSize)
+                    cacheTime[v] = timestamp++;
+            }
+            emitted[t] = true;
+        }
+
+        // Next fanning vertex: the oldest candidate that will still be in the cache after its fan
+        int next = -1, bestPriority = -1;
+        for (int v : candidates)
+        {
+            if (live[v] <= 0)
+                continue;
+            int priority = 0;
+            if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = timestamp - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                next = v;
+                bestPriority = priority;
+            }
+        }
+        if (next < 0)
+            next = skipDeadEnd(deadEnds, live, cursor);
+        fanning = next;
+    }
+
+    triangles.swap(output);
+}
+
+int VertexCache::skipDeadEnd(std::vector<int> &deadEnds, const std::vector<int> &live, int &cursor)
+{
+    // Recently used vertices first, then the first one in input order with triangles left
+    while (!deadEnds.empty())
+    {
+        int v = deadEnds.back();
+        deadEnds.pop_back();
+        if (live[v] > 0)
+            return v;
+    }
+    for (; cursor < int(live.size()); ++cursor)
+    {
+        if (live[cursor] > 0)
+            return cursor;
+    }
+    return -1;
+}
+
+int VertexCache::reorderVertices(std::vector<int> &triangles, int nVertices, std::vector<int> &newIndex)
+{
+    newIndex.assign(nVertices, -1);
+    int used = 0;
+    for (int &index : triangles)
+    {
+        if (newIndex[index] < 0)
+            newIndex[index] = used++;
+        index = newIndex[index];
+    }
+    return used;
+}
+
+VertexCacheStats VertexCache::measure(const int *triangles, size_t nTriangles, int nVertices, int cacheSize)
+{
+    // FIFO cache: a vertex is cached while fewer than cacheSize misses happened since its own
+    std::vector<long long> missedAt(nVertices, -1);
+    std::vector<bool> used(nVertices, false);
+    long long misses = 0;
+    int nUsed = 0;
+    for (size_t i = 0; i < 3 * nTriangles; ++i)
+    {
+        int v = triangles[i];
+        if (missedAt[v] < 0 || misses - missedAt[v] >= cacheSize)
+            missedAt[v] = misses++;
+        if (!used[v])
+        {
+            used[v] = true;
+            ++nUsed;
+        }
+    }
+
+    VertexCacheStats stats = {};
+    if (nTriangles > 0)
+    {
+        stats.acmr = float(misses) / nTriangles;
+        stats.atvr = float(misses) / nUsed;
+    }
+    return stats;
+}
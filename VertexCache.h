@@ -0,0 +1,37 @@
+#ifndef VERTEXCACHE_H
+#define VERTEXCACHE_H
+
+#include <cstddef>
+#include <vector>
+
+// Entries of the post-transform vertex cache that the index order is tuned for
+constexpr int VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats
+{
+    float acmr; // Average cache miss ratio: vertices transformed per triangle
+    float atvr; // Average transform to vertex ratio: vertices transformed per vertex
+};
+
+// VertexCache reorders index buffers so that the GPU reuses more transformed
+// vertices, and measures that reuse by simulating a FIFO cache. Reordering
+// uses Tipsify (Sander, Nehab and Barczak, 2007), which runs in linear time.
+// A non-indexed triangle soup has an ACMR of 3 and an ATVR of 1.
+
+class VertexCache
+{
+
+public:
+    // Reorders the triangles, keeping the orientation of each of them
+    static void optimize(std::vector<int> &triangles, int nVertices, int cacheSize = VERTEX_CACHE_SIZE);
+
+    // Renumbers the vertices in order of first use, newIndex is -1 for the unused ones. Returns the number used
+    static int reorderVertices(std::vector<int> &triangles, int nVertices, std::vector<int> &newIndex);
+
+    static VertexCacheStats measure(const int *triangles, size_t nTriangles, int nVertices, int cacheSize = VERTEX_CACHE_SIZE);
+
+private:
+    static int skipDeadEnd(std::vector<int> &deadEnds, const std::vector<int> &live, int &cursor);
+};
+
+#endif // VERTEXCACHE_H
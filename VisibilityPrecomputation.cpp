@@ -2,6 +2,8 @@
 #include "glm/glm.hpp"
 #include <glm/gtx/hash.hpp>
 
+#include "Trace.h"
+
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
@@ -151,6 +153,7 @@ public:
 
     void sampleRays(int n)
     {
+        TRACE_SCOPE("VisibilityPrecomputation::sampleRays");
         for (int i = 0; i < n; ++i) {
             Ray ray = generateRay();
             traverseRay(ray);
@@ -248,6 +251,7 @@ private:
 
 std::string DEFAULT_FILENAME = "test";
 constexpr int DEFAULT_N_RAYS = 1e6; 
+std::string TRACE_FILENAME = "visibility_trace.json";
 
 int main(int argc, char **argv)
 {
@@ -265,6 +269,7 @@ int main(int argc, char **argv)
     if (vis.readFloorPlan(filename)) {
         vis.sampleRays(n_rays);
         vis.writeVisibility(filename);
+        TRACE_WRITE(TRACE_FILENAME);
     }
     else std::cerr << "Couldn't load floor plan." << std::endl;
 }
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "WallTiles.h"
+
+static bool wallAt(const std::vector<std::vector<bool>> &isWall, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < int(isWall.size()) && y < int(isWall[x].size()) && isWall[x][y];
+}
+
+// Calls emit(start, end) for every maximal run of [begin, end) where inRun holds
+template <typename InRun, typename Emit>
+static void forEachRun(int begin, int end, InRun inRun, Emit emit)
+{
+    int start = -1;
+    for (int i = begin; i <= end; ++i)
+    {
+        bool in = i < end && inRun(i);
+        if (in && start < 0)
+            start = i;
+        else if (!in && start >= 0)
+        {
+            emit(start, i);
+            start = -1;
+        }
+    }
+}
+
+WallTiles::WallTiles()
+{
+    nTriangles = 0;
+}
+
+void WallTiles::build(const std::vector<std::vector<bool>> &isWall, GeometryArena &arena)
+{
+    free();
+    int width = isWall.size();
+    int height = width > 0 ? isWall[0].size() : 0;
+
+    for (int x = 0; x < width; x += WALL_TILE_SIZE)
+    {
+        for (int y = 0; y < height; y += WALL_TILE_SIZE)
+        {
+            glm::ivec2 first(x, y);
+            glm::ivec2 last = glm::min(first + WALL_TILE_SIZE, glm::ivec2(width, height));
+
+            TriangleMesh tile;
+            addTopAndBottom(tile, isWall, first, last);
+            addSides(tile, isWall, first, last);
+            if (tile.triangles.empty())
+                continue;
+
+            std::vector<glm::vec3> corners;
+            for (int vertex : tile.triangles)
+                corners.push_back(tile.vertices[vertex]);
+            occluders.push_back(std::move(corners));
+
+            tile.sendToOpenGL(arena);
+            tile.freeGeometry();
+            nTriangles += tile.getTriangleCount();
+            tiles.push_back(std::move(tile));
+        }
+    }
+}
+
+void WallTiles::free()
+{
+    for (TriangleMesh &tile : tiles)
+        tile.free();
+    tiles.clear();
+    occluders.clear();
+    nTriangles = 0;
+}
+
+const std::vector<TriangleMesh> &WallTiles::getTiles() const
+{
+    return tiles;
+}
+
+const std::vector<glm::vec3> &WallTiles::getOccluders(int tile) const
+{
+    return occluders[tile];
+}
+
+int WallTiles::getTriangleCount() const
+{
+    return nTriangles;
+}
+
+void WallTiles::addQuad(TriangleMesh &mesh, const glm::vec3 &origin, const glm::vec3 &u, const glm::vec3 &v)
+{
+    // Corners aren't shared between quads, so that each face keeps its own normal
+    int first = mesh.vertices.size();
+    mesh.addVertex(origin);
+    mesh.addVertex(origin + u);
+    mesh.addVertex(origin + u + v);
+    mesh.addVertex(origin + v);
+    mesh.addTriangle(first, first + 1, first + 2);
+    mesh.addTriangle(first, first + 2, first + 3);
+}
+
+void WallTiles::addTopAndBottom(TriangleMesh &mesh, const std::vector<std::vector<bool>> &isWall, const glm::ivec2 &first, const glm::ivec2 &last)
+{
+    glm::ivec2 size = last - first;
+    std::vector<bool> merged(size.x * size.y, false);
+    auto available = [&](int x, int y) {
+        return wallAt(isWall, x, y) && !merged[(x - first.x) * size.y + (y - first.y)];
+    };
+
+    // Grow each rectangle along x first, then along y while whole rows fit
+    for (int y = first.y; y < last.y; ++y)
+    {
+        for (int x = first.x; x < last.x; ++x)
+        {
+            if (!available(x, y))
+                continue;
+            int x1 = x + 1;
+            while (x1 < last.x && available(x1, y))
+                ++x1;
+            int y1 = y + 1;
+            for (bool fits = true; fits && y1 < last.y; )
+            {
+                for (int i = x; i < x1 && fits; ++i)
+                    fits = available(i, y1);
+                if (fits)
+                    ++y1;
+            }
+            for (int i = x; i < x1; ++i)
+            {
+                for (int j = y; j < y1; ++j)
+                    merged[(i - first.x) * size.y + (j - first.y)] = true;
+            }
+
+            float dx = x1 - x, dz = y1 - y;
+            addQuad(mesh, glm::vec3(x, 1.0f, y), glm::vec3(0.0f, 0.0f, dz), glm::vec3(dx, 0.0f, 0.0f));
+            addQuad(mesh, glm::vec3(x, 0.0f, y), glm::vec3(dx, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, dz));
+        }
+    }
+}
+
+void WallTiles::addSides(TriangleMesh &mesh, const std::vector<std::vector<bool>> &isWall, const glm::ivec2 &first, const glm::ivec2 &last)
+{
+    const glm::vec3 up(0.0f, 1.0f, 0.0f);
+
+    // Faces towards x are merged along y (world z), faces towards y along x
+    for (int x = first.x; x < last.x; ++x)
+    {
+        forEachRun(first.y, last.y, [&](int y) { return wallAt(isWall, x, y) && !wallAt(isWall, x + 1, y); },
+                   [&](int y0, int y1) { addQuad(mesh, glm::vec3(x + 1, 0.0f, y0), up, glm::vec3(0.0f, 0.0f, y1 - y0)); });
+        forEachRun(first.y, last.y, [&](int y) { return wallAt(isWall, x, y) && !wallAt(isWall, x - 1, y); },
+                   [&](int y0, int y1) { addQuad(mesh, glm::vec3(x, 0.0f, y0), glm::vec3(0.0f, 0.0f, y1 - y0), up); });
+    }
+    for (int y = first.y; y < last.y; ++y)
+    {
+        forEachRun(first.x, last.x, [&](int x) { return wallAt(isWall, x, y) && !wallAt(isWall, x, y + 1); },
+                   [&](int x0, int x1) { addQuad(mesh, glm::vec3(x0, 0.0f, y + 1), glm::vec3(x1 - x0, 0.0f, 0.0f), up); });
+        forEachRun(first.x, last.x, [&](int x) { return wallAt(isWall, x, y) && !wallAt(isWall, x, y - 1); },
+                   [&](int x0, int x1) { addQuad(mesh, glm::vec3(x0, 0.0f, y), up, glm::vec3(x1 - x0, 0.0f, 0.0f)); });
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef WALLTILES_H
+#define WALLTILES_H
+
+#include "GeometryArena.h"
+#include "TriangleMesh.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Cells along each side of a wall tile
+constexpr int WALL_TILE_SIZE = 16;
+
+// WallTiles builds the static geometry of the walls of a floor plan. Faces
+// between adjacent wall cells are removed and coplanar faces are greedily
+// merged into large quads. The result is split into square tiles of cells,
+// each one a mesh in world coordinates that can be culled on its own. The
+// triangles of each tile are also kept on the CPU, as occluders.
+
+class WallTiles
+{
+
+public:
+    WallTiles();
+
+    // isWall[x][y] tells whether the cell (x,y) is a wall, cells outside the plan are not
+    void build(const std::vector<std::vector<bool>> &isWall, GeometryArena &arena);
+    void free();
+
+    const std::vector<TriangleMesh> &getTiles() const;
+
+    // 3 corners per triangle of the tile, counter clockwise seen from outside
+    const std::vector<glm::vec3> &getOccluders(int tile) const;
+
+    int getTriangleCount() const;
+
+private:
+    // Adds the quad origin + [0,1]u + [0,1]v, facing towards cross(u, v)
+    static void addQuad(TriangleMesh &mesh, const glm::vec3 &origin, const glm::vec3 &u, const glm::vec3 &v);
+
+    static void addTopAndBottom(TriangleMesh &mesh, const std::vector<std::vector<bool>> &isWall, const glm::ivec2 &first, const glm::ivec2 &last);
+    static void addSides(TriangleMesh &mesh, const std::vector<std::vector<bool>> &isWall, const glm::ivec2 &first, const glm::ivec2 &last);
+
+private:
+    std::vector<TriangleMesh> tiles;
+    std::vector<std::vector<glm::vec3>> occluders;
+    int nTriangles;
+};
+
+#endif // WALLTILES_H
@@ -6,6 +6,7 @@
 #include "imgui_impl_opengl3.h"
 
 #include "Application.h"
+#include "Trace.h"
 
 #include <iostream>
 #include <string>
@@ -19,6 +20,8 @@
 #define GLUT_SCROLL_DOWN    0x0004
 
 std::string DEFAULT_SCENE = "scenes/test";
+std::string DEFAULT_PLAYBACK_CSV = "playback.csv";
+std::string TRACE_FILENAME = "trace.json";
 
 static int prevTime;
 static bool capturingMouse;
@@ -138,6 +141,8 @@ static void resizeCallback(int width, int height)
 
 static void drawCallback()
 {
+    TRACE_SCOPE("Frame");
+
     // Start the Dear ImGui frame
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGLUT_NewFrame();
@@ -146,14 +151,29 @@ static void drawCallback()
     Application::instance().render();
 
     // Render the Dear ImGui frame (with the calls to Dear ImGui that the applcation has made)
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    {
+        FrameProfiler &profiler = Application::instance().getProfiler();
+        StageTimer timer(profiler, TIMER_IMGUI);
+        TRACE_SCOPE("ImGui");
+        profiler.beginGpu(TIMER_GPU_IMGUI);
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler.endGpu(TIMER_GPU_IMGUI);
+    }
+    Application::instance().endFrame();
 
     glutSwapBuffers();
 }
 
 static void idleCallback()
 {
+    // Played back frames follow each other as fast as they can be drawn, with a fixed timestep
+    if (Application::instance().isPlayingBack()) {
+        if (!Application::instance().update(0)) glutLeaveMainLoop();
+        glutPostRedisplay();
+        return;
+    }
+
     int currentTime = glutGet(GLUT_ELAPSED_TIME);
     int deltaTime = currentTime - prevTime;
 
@@ -171,8 +191,16 @@ int main(int argc, char **argv)
     std::string scene = DEFAULT_SCENE;
     if (argc > 1) scene = argv[1];
 
+    // A camera path is played back instead of flying around
+    std::string cameraPath;
+    if (argc > 2) cameraPath = argv[2];
+    std::string playbackCsv = DEFAULT_PLAYBACK_CSV;
+    if (argc > 3) playbackCsv = argv[3];
+
     // GLUT initialization
     glutInit(&argc, argv);
+    // Return from glutMainLoop instead of exiting, so that the trace and the cleanup below run
+    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
     glutInitWindowPosition(100, 100);
     glutInitWindowSize(640, 480);
@@ -188,7 +216,7 @@ int main(int argc, char **argv)
     glutMouseFunc(mouseCallback);
     glutMotionFunc(motionCallback);
     glutPassiveMotionFunc(passiveMotionCallback);
-    beginCapturingMouse();
+    if (cameraPath.empty()) beginCapturingMouse();
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -206,16 +234,26 @@ int main(int argc, char **argv)
 
     // Application instance initialization
     Application::instance().init();
-    if (Application::instance().loadScene(scene)) {
+    int status = 0;
+    if (!Application::instance().loadScene(scene)) {
+        std::cerr << "Couldn't load scene." << std::endl;
+        status = -1;
+    }
+    else if (!cameraPath.empty() && !Application::instance().startPlayback(cameraPath, playbackCsv)) {
+        std::cerr << "Couldn't start the camera path playback." << std::endl;
+        status = -1;
+    }
+    else {
         prevTime = glutGet(GLUT_ELAPSED_TIME);
         glutMainLoop();
     }
-    else std::cerr << "Couldn't load scene." << std::endl;
+    Application::instance().stopLoading();
+    TRACE_WRITE(TRACE_FILENAME);
 
     // Dear ImGui cleanup
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGLUT_Shutdown();
     ImGui::DestroyContext();
 
-    return 0;
+    return status;
 }
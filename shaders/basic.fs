@@ -5,8 +5,8 @@
 // e: Eye space
 
 in vec3 eNormal;
+in vec4 vColor;
 
-uniform vec4 color;
 uniform int bLighting;
 
 out vec4 fragColor;
@@ -26,6 +26,6 @@ void main()
     }
 
     // Modulate color with lighting and apply gamma correction
-    fragColor = pow(lighting * color, vec4(1.0 / 2.1));
+    fragColor = pow(lighting * vColor, vec4(1.0 / 2.1));
 }
 
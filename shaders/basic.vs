@@ -1,19 +1,27 @@
 #version 330 core
 
-in vec3 mPos;
-in vec3 mNormal;
+layout(location = 0) in vec3 mPos;
+layout(location = 1) in vec3 mNormal;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat3 normalMatrix;
+// Per instance, see InstanceBuffer.h
+layout(location = 2) in mat4 iModel;
+layout(location = 6) in vec4 iColor;
+
+// Uploaded once per frame, see Scene::render
+layout(std140) uniform Frame
+{
+  mat4 view;
+  mat4 projection;
+};
 
 out vec3 eNormal;
+out vec4 vColor;
 
 void main()
 {
-  // Transform matrix to viewspace
-  eNormal = normalMatrix * mNormal;
-	gl_Position = projection * view * model * vec4(mPos, 1.0);
+  // Models are only translated, so the rotation of modelView is enough to transform normals to viewspace
+  mat4 modelView = view * iModel;
+  eNormal = mat3(modelView) * mNormal;
+  vColor = iColor;
+	gl_Position = projection * modelView * vec4(mPos, 1.0);
 }
-